@@ -0,0 +1,1384 @@
+// Benchmarks for Yule's hot paths. Everything here is driven through the same headers
+// the application uses, with fixed workloads so numbers can be compared run to run.
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../Yule/ParticleSystem.hpp"
+#include "../Yule/ParticleDistribution.hpp"
+#include "../Yule/ParticleKernels.hpp"
+#include "../Yule/console-utils.hpp"
+#include "../Yule/FramePacer.hpp"
+#include "../Yule/PointBatch.hpp"
+#include "../Yule/WorkerPool.hpp"
+
+typedef std::chrono::steady_clock BenchClock;
+
+// Heap allocation counter, fed by the global operator new replacements below. Atomic, since
+// the render thread and worker pools allocate too.
+static std::atomic<size_t> allocationCount(0);
+
+// Number of benchmark checks that did not hold. Becomes the exit code.
+static int benchFailures = 0;
+
+// Where timed loops leave their results, so the work can't be optimized out.
+static volatile double benchSink = 0;
+
+// Scratch for drawing particles, kept between frames the same as Yule's.
+static PointBatch benchPoints;
+
+// Every form of new and delete is replaced, all going through malloc and free, so whichever
+// pair the compiler picks they match. GCC can't tell that new now means malloc, and warns
+// about the free behind every delete it inlines, so that warning is off for these.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+/// <summary>
+/// Counts and makes an allocation for every form of new. Null if out of memory.
+/// </summary>
+/// <param name="size"></param>
+/// <returns></returns>
+static void* benchAllocate(size_t size) noexcept
+{
+  ++allocationCount;
+  return malloc(size == 0 ? 1 : size);
+}
+
+void* operator new(size_t size)
+{
+  void* memory = benchAllocate(size);
+  if (memory == nullptr)
+  {
+    throw std::bad_alloc();
+  }
+  return memory;
+}
+
+void* operator new[](size_t size)
+{
+  void* memory = benchAllocate(size);
+  if (memory == nullptr)
+  {
+    throw std::bad_alloc();
+  }
+  return memory;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+  return benchAllocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+  return benchAllocate(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+  free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+  free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+  free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept
+{
+  free(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept
+{
+  free(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept
+{
+  free(memory);
+}
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+/// <summary>
+/// Minimal stand-in for Yule's ParticleData, so the benchmarks carry the same payload.
+/// </summary>
+struct BenchData
+{
+  char visual;
+  double startLife;
+
+  BenchData()
+    : visual('*')
+    , startLife(0)
+  { }
+};
+
+/// <summary>
+/// Spawns long-lived particles moving in pseudo-random directions, so nothing dies
+/// during a timed run and the particle count stays fixed.
+/// </summary>
+/// <param name="p"></param>
+/// <param name="random">the system's generator</param>
+void BenchCreateParticle(Particle<BenchData>& p, ParticleRandom& random)
+{
+  p.VelX = random.NextRange(-100, 100) / 30.0;
+  p.VelY = random.NextRange(-100, 100) / 10.0;
+  p.Life = 1000000;
+  p.Data.startLife = p.Life;
+}
+
+/// <summary>
+/// Fire-like spawn: short, varied lifetimes so particles are constantly dying and respawning.
+/// </summary>
+/// <param name="p"></param>
+/// <param name="random">the system's generator</param>
+void BenchCreateFlameParticle(Particle<BenchData>& p, ParticleRandom& random)
+{
+  p.VelX = random.NextRange(-100, 100) / 30.0;
+  p.VelY = random.NextRange(-100, 100) / 10.0;
+  p.Life = random.NextRange(0.5, 5);
+  p.Data.startLife = p.Life;
+}
+
+/// <summary>
+/// Per-frame update used to compare policy dispatch: a little drag on both axes.
+/// </summary>
+/// <param name="dt"></param>
+/// <param name="p"></param>
+void BenchDragParticle(double dt, ParticleRef<BenchData> p)
+{
+  p.VelX -= p.VelX * 0.5 * dt;
+  p.VelY -= p.VelY * 0.5 * dt;
+}
+
+/// <summary>
+/// Per-frame update that jitters velocity with the chunk's generator, so a parallel update
+/// only comes out the same every time if the generator is seeded per chunk.
+/// </summary>
+/// <param name="dt"></param>
+/// <param name="p"></param>
+void BenchJitterParticle(double dt, ParticleRef<BenchData> p)
+{
+  p.VelX += ParticleRandom::Chunk().NextRange(-10, 10) * dt;
+  p.VelY += ParticleRandom::Chunk().NextRange(-10, 10) * dt;
+}
+
+/// <summary>
+/// Compile-time policy versions of the callbacks above.
+/// </summary>
+struct BenchSpawnPolicy
+{
+  void operator()(Particle<BenchData>& p, ParticleRandom& random) const { BenchCreateParticle(p, random); }
+};
+
+struct BenchDragPolicy
+{
+  void operator()(double dt, ParticleRef<BenchData> p) const { BenchDragParticle(dt, p); }
+};
+
+/// <summary>
+/// Elapsed time since a start point, in microseconds.
+/// </summary>
+/// <param name="start"></param>
+/// <returns></returns>
+double MicrosecondsSince(BenchClock::time_point start)
+{
+  return std::chrono::duration<double, std::micro>(BenchClock::now() - start).count();
+}
+
+/// <summary>
+/// Per-frame cost of ParticleSystem::Update at a given particle count.
+/// </summary>
+/// <param name="count">number of live particles</param>
+void BenchParticleUpdate(size_t count)
+{
+  const double dt = 0.004;
+  ParticleSystem<BenchData> system(static_cast<int>(count), 0, true, BenchData(), BenchCreateParticle, nullptr);
+  system.Update(dt); // Fills the system up to max.
+
+  // Scale the frame count so every size does roughly the same amount of work.
+  const size_t frames = count >= 2000000 ? 10 : 20000000 / count;
+  BenchClock::time_point start = BenchClock::now();
+  for (size_t i = 0; i < frames; ++i)
+  {
+    system.Update(dt);
+  }
+  const double total = MicrosecondsSince(start);
+
+  printf("particle_update    particles=%-8zu frames=%-8zu us/frame=%.3f\n", count, frames, total / frames);
+}
+
+/// <summary>
+/// Compares the integration kernels on the same particle batch. Life is set high enough that
+/// nothing dies, so every pass does identical work.
+/// </summary>
+/// <param name="count">number of particles in the batch</param>
+void BenchIntegrateKernels(size_t count)
+{
+  std::vector<double> posX(count, 0), posY(count, 0), velX(count), velY(count), life(count, 1000000);
+  std::vector<unsigned char> kill(count);
+  for (size_t i = 0; i < count; ++i)
+  {
+    velX[i] = (rand() % 200 - 100) / 30.0;
+    velY[i] = (rand() % 200 - 100) / 10.0;
+  }
+
+  const CpuFeatures::SimdLevel levels[] = { CpuFeatures::SIMD_SCALAR, CpuFeatures::SIMD_SSE2, CpuFeatures::SIMD_AVX2 };
+  const size_t frames = 20000000 / count;
+  for (CpuFeatures::SimdLevel level : levels)
+  {
+    if (level > CpuFeatures::GetSimdLevel())
+    {
+      continue;
+    }
+
+    ParticleKernels::IntegrateFunc integrate = ParticleKernels::GetIntegrate(level);
+    BenchClock::time_point start = BenchClock::now();
+    for (size_t i = 0; i < frames; ++i)
+    {
+      integrate(count, posX.data(), posY.data(), velX.data(), velY.data(), life.data(), 0.004, 0, -5, kill.data());
+    }
+    const double total = MicrosecondsSince(start);
+
+    printf("integrate_kernel   particles=%-8zu simd=%-7s us/frame=%.3f\n", count, CpuFeatures::GetSimdLevelName(level), total / frames);
+  }
+}
+
+/// <summary>
+/// Times Update on an already-filled system, returning microseconds per frame.
+/// </summary>
+template <typename System> double TimeSystemUpdate(System& system, size_t frames)
+{
+  const double dt = 0.004;
+  system.Update(dt);
+
+  BenchClock::time_point start = BenchClock::now();
+  for (size_t i = 0; i < frames; ++i)
+  {
+    system.Update(dt);
+  }
+  return MicrosecondsSince(start) / frames;
+}
+
+/// <summary>
+/// The same per-particle update through the std::function adapter and through a functor policy.
+/// </summary>
+/// <param name="count">number of live particles</param>
+void BenchUpdatePolicies(size_t count)
+{
+  const size_t frames = 20000000 / count;
+
+  ParticleSystem<BenchData> erased(static_cast<int>(count), 0, true, BenchData(), BenchCreateParticle, BenchDragParticle);
+  const double erasedTime = TimeSystemUpdate(erased, frames);
+
+  ParticleSystem<BenchData, BenchSpawnPolicy, BenchDragPolicy> policy(static_cast<int>(count), 0, true, BenchData());
+  const double policyTime = TimeSystemUpdate(policy, frames);
+
+  printf("update_policy      particles=%-8zu std::function us/frame=%.3f  functor us/frame=%.3f\n", count, erasedTime, policyTime);
+}
+
+/// <summary>
+/// Runs a fire of the specified size for a number of frames and returns microseconds per
+/// frame. A threshold of 0 always updates in parallel, SIZE_MAX never does.
+/// </summary>
+/// <param name="system">filled system to run</param>
+/// <param name="threshold">parallel threshold to run at</param>
+/// <param name="pool">pool to run on</param>
+/// <param name="frames"></param>
+template <typename System> double TimeParallelUpdate(System& system, size_t threshold, WorkerPool& pool, size_t frames)
+{
+  system.SetParallelThreshold(threshold);
+  system.SetWorkerPool(&pool);
+  return TimeSystemUpdate(system, frames);
+}
+
+/// <summary>
+/// Serial against parallel update for a fire of the specified size, with particles dying
+/// and respawning all the while. Then checks that a parallel update with a jittering update
+/// policy ends up exactly the same on pools of different sizes.
+/// </summary>
+/// <param name="count">number of live particles</param>
+void BenchParallelUpdate(size_t count)
+{
+  const size_t frames = count >= 1000000 ? 20 : 20000000 / count;
+  ParticleSystem<BenchData> serial(static_cast<int>(count), 0, true, BenchData(), BenchCreateFlameParticle, nullptr);
+  serial.SetSeed(7);
+  const double serialTime = TimeParallelUpdate(serial, SIZE_MAX, WorkerPool::Shared(), frames);
+  ParticleSystem<BenchData> parallel(static_cast<int>(count), 0, true, BenchData(), BenchCreateFlameParticle, nullptr);
+  parallel.SetSeed(7);
+  const double parallelTime = TimeParallelUpdate(parallel, 0, WorkerPool::Shared(), frames);
+
+  // Same seeds, different numbers of threads.
+  WorkerPool small(1);
+  ParticleSystem<BenchData> runs[2] =
+  {
+    ParticleSystem<BenchData>(static_cast<int>(count), 0, true, BenchData(), BenchCreateFlameParticle, BenchJitterParticle),
+    ParticleSystem<BenchData>(static_cast<int>(count), 0, true, BenchData(), BenchCreateFlameParticle, BenchJitterParticle)
+  };
+  for (int run = 0; run < 2; ++run)
+  {
+    runs[run].SetSeed(42);
+    TimeParallelUpdate(runs[run], 0, run == 0 ? small : WorkerPool::Shared(), 50);
+  }
+
+  bool isSame = runs[0].Particles().size() == runs[1].Particles().size();
+  ConstParticleView<BenchData> a = static_cast<const ParticleSystem<BenchData>&>(runs[0]).Particles();
+  ConstParticleView<BenchData> b = static_cast<const ParticleSystem<BenchData>&>(runs[1]).Particles();
+  for (ConstParticleView<BenchData>::Iterator i = a.begin(), j = b.begin(); isSame && i != a.end(); ++i, ++j)
+  {
+    isSame = (*i).PosX == (*j).PosX && (*i).PosY == (*j).PosY && (*i).VelX == (*j).VelX && (*i).Life == (*j).Life;
+  }
+
+  printf("parallel_update    particles=%-8zu threads=%-3zu us/frame serial=%.3f parallel=%.3f\n",
+    count, WorkerPool::Shared().GetThreadCount(), serialTime, parallelTime);
+  if (!isSame)
+  {
+    printf("FAIL: parallel update came out differently on a different number of threads\n");
+    ++benchFailures;
+  }
+}
+
+/// <summary>
+/// Yule's fire spawn as it was on rand(), with a log10 per particle for its lifetime.
+/// </summary>
+/// <param name="p"></param>
+void BenchCreateRandParticle(Particle<BenchData>& p)
+{
+  p.VelX = (rand() % 200 - 100) / 30.0;
+  p.VelY = (rand() % 200 - 100) / 10.0;
+  p.PosX = 40 + (rand() % 8 - 4);
+  const double rand0to30 = (rand() % 30000 / 1000.0);
+  p.Life = 2 - log10(rand0to30 + .001);
+  p.Data.visual = "**.oo"[rand() % 5];
+  p.Data.startLife = p.Life;
+}
+
+/// <summary>
+/// The same spawn drawing from the system's generator, with lifetimes from a table.
+/// </summary>
+/// <param name="p"></param>
+/// <param name="random"></param>
+/// <param name="lifetimes">the log10 curve, baked</param>
+void BenchCreateTableParticle(Particle<BenchData>& p, ParticleRandom& random, const ParticleDistribution& lifetimes)
+{
+  p.VelX = random.NextRange(-100, 100) / 30.0;
+  p.VelY = random.NextRange(-100, 100) / 10.0;
+  p.PosX = 40 + (static_cast<int>(random.NextBelow(8)) - 4);
+  p.Life = 2 + lifetimes.Sample(random);
+  p.Data.visual = "**.oo"[random.NextBelow(5)];
+  p.Data.startLife = p.Life;
+}
+
+/// <summary>
+/// Runs a spawn function over a particle the specified number of times, returning
+/// nanoseconds per spawn.
+/// </summary>
+template <typename Spawn> double TimeSpawns(size_t count, Spawn spawn)
+{
+  Particle<BenchData> p = Particle<BenchData>(BenchData());
+  double total = 0;
+  BenchClock::time_point start = BenchClock::now();
+  for (size_t i = 0; i < count; ++i)
+  {
+    spawn(p);
+    total += p.Life + p.VelX;
+  }
+  const double elapsed = MicrosecondsSince(start);
+  benchSink = total;
+  return elapsed * 1000 / count;
+}
+
+/// <summary>
+/// Cost of random numbers one at a time from rand() and from ParticleRandom, and in a batch
+/// from ParticleRandom::Fill; then the fire spawn on each. Also checks that a batch matches
+/// the same numbers drawn one at a time, and that a system's spawns follow its seed alone.
+/// </summary>
+/// <param name="count">numbers, and spawns, to time</param>
+void BenchRandom(size_t count)
+{
+  ParticleRandom random(7);
+  std::vector<double> batch(count);
+
+  double total = 0;
+  BenchClock::time_point start = BenchClock::now();
+  for (size_t i = 0; i < count; ++i)
+  {
+    total += rand() / (RAND_MAX + 1.0);
+  }
+  const double randTime = MicrosecondsSince(start) * 1000 / count;
+
+  start = BenchClock::now();
+  for (size_t i = 0; i < count; ++i)
+  {
+    total += random.NextDouble();
+  }
+  const double nextTime = MicrosecondsSince(start) * 1000 / count;
+
+  start = BenchClock::now();
+  random.Fill(batch.data(), count);
+  const double fillTime = MicrosecondsSince(start) * 1000 / count;
+  benchSink = total + batch[count / 2];
+
+  const ParticleDistribution lifetimes([](double uniform) { return -log10(uniform * 30 + .001); });
+  const double randSpawnTime = TimeSpawns(count, [](Particle<BenchData>& p) { BenchCreateRandParticle(p); });
+  const double tableSpawnTime = TimeSpawns(count, [&](Particle<BenchData>& p) { BenchCreateTableParticle(p, random, lifetimes); });
+
+  printf("random             numbers=%-8zu ns/number rand=%.2f next=%.2f fill=%.2f\n", count, randTime, nextTime, fillTime);
+  printf("random_spawn       spawns=%-8zu ns/spawn rand+log10=%.2f generator+table=%.2f\n", count, randSpawnTime, tableSpawnTime);
+
+  // A batch is the same numbers as drawing them one by one.
+  ParticleRandom one(11);
+  ParticleRandom many(11);
+  many.Fill(batch.data(), 1000, -3, 5);
+  bool isSame = true;
+  for (size_t i = 0; i < 1000; ++i)
+  {
+    isSame = isSame && batch[i] == one.NextRange(-3, 5);
+  }
+  if (!isSame)
+  {
+    printf("FAIL: ParticleRandom::Fill gave different numbers than NextRange\n");
+    ++benchFailures;
+  }
+
+  // Systems seeded alike spawn alike, even with other draws on rand() in between; another
+  // seed spawns something else.
+  ParticleSystem<BenchData> systems[3] =
+  {
+    ParticleSystem<BenchData>(1000, 0, true, BenchData(), BenchCreateFlameParticle, nullptr),
+    ParticleSystem<BenchData>(1000, 0, true, BenchData(), BenchCreateFlameParticle, nullptr),
+    ParticleSystem<BenchData>(1000, 0, true, BenchData(), BenchCreateFlameParticle, nullptr)
+  };
+  const uint64_t seeds[3] = { 5, 5, 6 };
+  for (int run = 0; run < 3; ++run)
+  {
+    systems[run].SetSeed(seeds[run]);
+    for (int frame = 0; frame < 100; ++frame)
+    {
+      systems[run].Update(0.01);
+      benchSink = rand();
+    }
+  }
+
+  ConstParticleView<BenchData> a = static_cast<const ParticleSystem<BenchData>&>(systems[0]).Particles();
+  ConstParticleView<BenchData> b = static_cast<const ParticleSystem<BenchData>&>(systems[1]).Particles();
+  ConstParticleView<BenchData> c = static_cast<const ParticleSystem<BenchData>&>(systems[2]).Particles();
+  bool isRepeatable = a.size() == b.size();
+  bool isSeeded = a.size() != c.size();
+  for (ConstParticleView<BenchData>::Iterator i = a.begin(), j = b.begin(), k = c.begin(); i != a.end() && j != b.end() && k != c.end(); ++i, ++j, ++k)
+  {
+    isRepeatable = isRepeatable && (*i).PosX == (*j).PosX && (*i).VelY == (*j).VelY && (*i).Life == (*j).Life;
+    isSeeded = isSeeded || (*i).Life != (*k).Life;
+  }
+  if (!isRepeatable || !isSeeded)
+  {
+    printf("FAIL: particle spawns didn't follow the system's seed\n");
+    ++benchFailures;
+  }
+}
+
+/// <summary>
+/// Counts heap allocations across steady-state frames of a looping fire system. Spawning
+/// reuses pool slots, so once the system is warmed up this should always be zero.
+/// </summary>
+void BenchSteadyStateAllocations()
+{
+  const double dt = 0.004;
+  const size_t frames = 10000;
+  ParticleSystem<BenchData> system(100, 0.015, true, BenchData(), BenchCreateFlameParticle, nullptr);
+  system.SetAcceleration(0, -5);
+
+  // Warm up until the pool has cycled through spawns and deaths.
+  for (size_t i = 0; i < 2000; ++i)
+  {
+    system.Update(dt);
+  }
+
+  const size_t before = allocationCount;
+  for (size_t i = 0; i < frames; ++i)
+  {
+    system.Update(dt);
+  }
+  const size_t allocations = allocationCount - before;
+
+  printf("steady_state_alloc frames=%-8zu allocations=%zu\n", frames, allocations);
+  if (allocations != 0)
+  {
+    printf("FAIL: steady-state particle frames allocated\n");
+    ++benchFailures;
+  }
+}
+
+/// <summary>
+/// Color for a bench particle: yellow for its first half of life, red after.
+/// </summary>
+/// <param name="p"></param>
+/// <returns></returns>
+RConsole::Color BenchParticleColor(const ConstParticleRef<BenchData>& p)
+{
+  return p.Life / p.Data.startLife > 0.5 ? RConsole::YELLOW : RConsole::RED;
+}
+
+/// <summary>
+/// Draws every particle in a system onto the canvas the same way Yule does: filled into a
+/// batch that's kept between frames, then drawn with one DrawPoints.
+/// </summary>
+/// <param name="system"></param>
+void BenchDrawParticles(const ParticleSystem<BenchData>& system)
+{
+  benchPoints.Draw(system.Particles(), 0, BenchParticleColor);
+}
+
+/// <summary>
+/// Regression check: drawing particles must not allocate once the batch they're drawn
+/// through has grown to fit. Drawing used to copy the whole particle list every frame.
+/// </summary>
+void BenchDrawAllocations()
+{
+  const double dt = 0.004;
+  const size_t frames = 1000;
+  RConsole::Canvas::ReInit(80, 25);
+  ParticleSystem<BenchData> system(100, 0.015, true, BenchData(), BenchCreateFlameParticle, nullptr);
+  system.SetPos(40, 22);
+  for (size_t i = 0; i < 2000; ++i)
+  {
+    system.Update(dt);
+  }
+
+  // The batch only grows until it fits the most particles the system can have.
+  benchPoints.Resize(system.GetMaxParticles());
+
+  const size_t before = allocationCount;
+  for (size_t i = 0; i < frames; ++i)
+  {
+    system.Update(dt);
+    BenchDrawParticles(system);
+  }
+  const size_t allocations = allocationCount - before;
+
+  printf("draw_alloc         frames=%-8zu particles=%-5zu allocations=%zu\n", frames, system.Particles().size(), allocations);
+  if (allocations != 0)
+  {
+    printf("FAIL: drawing particles allocated\n");
+    ++benchFailures;
+  }
+}
+
+/// <summary>
+/// Draws Yule's background log into a raster a cell at a time, the way it used to be drawn,
+/// and as a sprite. Both have to leave the raster exactly the same.
+/// </summary>
+void BenchSprite()
+{
+  const char *text =
+    "[legend]\n# 219\n= 178\n- 177\n. 176\n"
+    "[glyphs]\n"
+    " ##########--\n"
+    "#=========-==-\n"
+    "=========.==#-\n"
+    "==--------=-=-\n"
+    " ..........-=\n"
+    "[colors]\n"
+    " 666666666666\n"
+    "66666666666ee6\n"
+    "6666666666eee6\n"
+    "6666666666eee6\n"
+    " 8888888866e6\n";
+  const unsigned char shades[] = { 219, 178, 177, 176 };
+  const char *symbols = "#=-.";
+
+  RConsole::Sprite sprite;
+  if (!sprite.Load(text))
+  {
+    printf("FAIL: sprite didn't load\n");
+    ++benchFailures;
+    return;
+  }
+
+  // The same cells, as individual draws.
+  struct Cell { char glyph; int x; int y; RConsole::Color color; };
+  std::vector<Cell> cells;
+  const char *glyphs = strstr(text, "[glyphs]\n") + 9;
+  const char *colors = strstr(text, "[colors]\n") + 9;
+  for (int y = 0; *glyphs != '['; ++y)
+  {
+    for (int x = 0; *glyphs != '\n'; ++x, ++glyphs, ++colors)
+    {
+      if (*glyphs != ' ')
+      {
+        const int color = *colors <= '9' ? *colors - '0' : *colors - 'a' + 10;
+        const char glyph = static_cast<char>(shades[strchr(symbols, *glyphs) - symbols]);
+        cells.push_back(Cell{ glyph, x, y, static_cast<RConsole::Color>(color) });
+      }
+    }
+    ++glyphs;
+    ++colors;
+  }
+
+  const size_t draws = 200000;
+  const int x = 33;
+  const int y = 20;
+  RConsole::CanvasRaster cellRaster(80, 25);
+  cellRaster.Zero();
+  BenchClock::time_point start = BenchClock::now();
+  for (size_t i = 0; i < draws; ++i)
+  {
+    for (const Cell &cell : cells)
+    {
+      cellRaster.WriteChar(cell.glyph, static_cast<float>(x + cell.x), static_cast<float>(y + cell.y), cell.color);
+    }
+  }
+  const double perCell = MicrosecondsSince(start) * 1000.0 / draws;
+
+  RConsole::CanvasRaster spriteRaster(80, 25);
+  spriteRaster.Zero();
+  start = BenchClock::now();
+  for (size_t i = 0; i < draws; ++i)
+  {
+    spriteRaster.WriteSprite(sprite, x, y);
+  }
+  const double perSprite = MicrosecondsSince(start) * 1000.0 / draws;
+
+  const RConsole::Field2D<RConsole::RasterInfo> &cellData = static_cast<const RConsole::CanvasRaster &>(cellRaster).GetRasterData();
+  const RConsole::Field2D<RConsole::RasterInfo> &spriteData = static_cast<const RConsole::CanvasRaster &>(spriteRaster).GetRasterData();
+  bool isSame = true;
+  for (unsigned int i = 0; i < 80 * 25; ++i)
+  {
+    isSame = isSame && cellData.Peek(i) == spriteData.Peek(i) && cellData.Peek(i).IsModified() == spriteData.Peek(i).IsModified();
+  }
+
+  printf("sprite             cells=%-5zu runs=%-4zu ns/draw percell=%.1f sprite=%.1f\n", cells.size(), sprite.GetRunCount(), perCell, perSprite);
+  if (!isSame)
+  {
+    printf("FAIL: sprite drew differently than individual cells\n");
+    ++benchFailures;
+  }
+}
+
+/// <summary>
+/// Draws a cloud of points a call at a time through Canvas::Draw, and all at once through
+/// Canvas::DrawPoints. Some land off the canvas to exercise clipping. Both have to put out
+/// the same frame.
+/// </summary>
+/// <param name="count">points in the cloud</param>
+void BenchDrawPoints(size_t count)
+{
+  const unsigned int width = 240;
+  const unsigned int height = 67;
+  const size_t rounds = 20;
+  std::vector<float> x(count), y(count);
+  std::vector<char> glyphs(count);
+  std::vector<RConsole::Color> colors(count);
+  srand(7);
+  for (size_t i = 0; i < count; ++i)
+  {
+    x[i] = (rand() % ((width + 20) * 100)) / 100.0f - 10;
+    y[i] = (rand() % ((height + 10) * 100)) / 100.0f - 5;
+    glyphs[i] = "*.,'`"[rand() % 5];
+    colors[i] = static_cast<RConsole::Color>(rand() % 15);
+  }
+
+  double times[2] = { 0, 0 };
+  std::vector<char> captures[2];
+  for (int run = 0; run < 2; ++run)
+  {
+    const bool isBatched = run == 1;
+    RConsole::Canvas::SetOutputTarget(RConsole::TARGET_MEMORY);
+    RConsole::Canvas::ReInit(width, height);
+    RConsole::Canvas::Update();
+    RConsole::Canvas::ClearCapturedOutput();
+
+    BenchClock::time_point start = BenchClock::now();
+    for (size_t round = 0; round < rounds; ++round)
+    {
+      if (isBatched)
+      {
+        RConsole::Canvas::DrawPoints(x.data(), y.data(), glyphs.data(), colors.data(), count);
+      }
+      else
+      {
+        for (size_t i = 0; i < count; ++i)
+        {
+          RConsole::Canvas::Draw(glyphs[i], x[i], y[i], colors[i]);
+        }
+      }
+    }
+    times[run] = MicrosecondsSince(start) * 1000.0 / (rounds * count);
+
+    RConsole::Canvas::Update();
+    captures[run] = RConsole::Canvas::GetCapturedOutput();
+    RConsole::Canvas::ClearCapturedOutput();
+  }
+  RConsole::Canvas::SetOutputTarget(RConsole::TARGET_TERMINAL);
+
+  printf("draw_points        points=%-8zu ns/point percall=%.2f batched=%.2f\n", count, times[0], times[1]);
+  if (captures[0] != captures[1])
+  {
+    printf("FAIL: DrawPoints drew differently than Draw\n");
+    ++benchFailures;
+  }
+}
+
+/// <summary>
+/// Points stdout at /dev/null so frame output doesn't end up in the report. Returns the
+/// original descriptor, to be handed back to RestoreStdout.
+/// </summary>
+int SilenceStdout()
+{
+  fflush(stdout);
+  const int saved = dup(STDOUT_FILENO);
+  const int devNull = open("/dev/null", O_WRONLY);
+  dup2(devNull, STDOUT_FILENO);
+  close(devNull);
+  return saved;
+}
+
+/// <summary>
+/// Undoes SilenceStdout.
+/// </summary>
+/// <param name="saved"></param>
+void RestoreStdout(int saved)
+{
+  fflush(stdout);
+  dup2(saved, STDOUT_FILENO);
+  close(saved);
+}
+
+/// <summary>
+/// Renders a fire through Canvas::Update for a number of frames in the given output mode.
+/// Frame output goes to /dev/null; what's measured is building and writing it.
+/// </summary>
+/// <param name="mode"></param>
+/// <param name="width"></param>
+/// <param name="height"></param>
+void BenchFrameEmission(RConsole::OutputMode mode, bool minimized, unsigned int width, unsigned int height)
+{
+  const double dt = 0.004;
+  const size_t frames = 2000;
+  RConsole::Canvas::ReInit(width, height);
+  RConsole::Canvas::SetOutputMode(mode);
+  RConsole::Canvas::SetOutputMinimized(minimized);
+  ParticleSystem<BenchData> system(100, 0.015, true, BenchData(), BenchCreateFlameParticle, nullptr);
+  system.SetSeed(7);
+  system.SetAcceleration(0, -5);
+  system.SetPos(width / 2.0, height - 3.0);
+
+  const int saved = SilenceStdout();
+  size_t bytes = 0;
+  BenchClock::time_point start = BenchClock::now();
+  for (size_t i = 0; i < frames; ++i)
+  {
+    system.Update(dt);
+    BenchDrawParticles(system);
+    RConsole::Canvas::Update();
+    bytes += RConsole::Canvas::GetLastFrameBytes();
+  }
+  const double total = MicrosecondsSince(start);
+  RestoreStdout(saved);
+
+  const char *modeName = mode == RConsole::OUTPUT_DIRECT ? "direct" : minimized ? "minimal" : "buffered";
+  printf("frame_emission     size=%ux%-5u mode=%-9s us/frame=%.3f", width, height, modeName, total / frames);
+  if (mode == RConsole::OUTPUT_BUFFERED)
+  {
+    printf(" bytes/frame=%.1f", static_cast<double>(bytes) / frames);
+  }
+  printf("\n");
+}
+
+/// <summary>
+/// Renders a fire headless, straight into memory or a file, with no terminal involved at all.
+/// The same seed has to capture the same bytes every time, which only memory can show.
+/// </summary>
+/// <param name="target">TARGET_MEMORY, or TARGET_FILE for /dev/null</param>
+/// <param name="width"></param>
+/// <param name="height"></param>
+void BenchHeadless(RConsole::OutputTarget target, unsigned int width, unsigned int height)
+{
+  const double dt = 0.004;
+  const size_t frames = 2000;
+  size_t bytes = 0;
+  double total = 0;
+  std::vector<char> firstCapture;
+  bool isRepeatable = true;
+
+  for (int run = 0; run < 2; ++run)
+  {
+    RConsole::Canvas::SetOutputTarget(target, "/dev/null");
+    RConsole::Canvas::SetOutputMinimized(true);
+    RConsole::Canvas::ReInit(width, height);
+    ParticleSystem<BenchData> system(100, 0.015, true, BenchData(), BenchCreateFlameParticle, nullptr);
+    system.SetSeed(7);
+    system.SetAcceleration(0, -5);
+    system.SetPos(width / 2.0, height - 3.0);
+
+    bytes = 0;
+    BenchClock::time_point start = BenchClock::now();
+    for (size_t i = 0; i < frames; ++i)
+    {
+      system.Update(dt);
+      BenchDrawParticles(system);
+      RConsole::Canvas::Update();
+      bytes += RConsole::Canvas::GetLastFrameBytes();
+    }
+    total = MicrosecondsSince(start);
+
+    if (run == 0)
+      firstCapture = RConsole::Canvas::GetCapturedOutput();
+    else
+      isRepeatable = firstCapture == RConsole::Canvas::GetCapturedOutput();
+    RConsole::Canvas::ClearCapturedOutput();
+  }
+
+  RConsole::Canvas::SetOutputTarget(RConsole::TARGET_TERMINAL);
+  printf("headless           size=%ux%-5u target=%-6s us/frame=%.3f fps=%.0f bytes/frame=%.1f repeatable=%s\n",
+    width, height, target == RConsole::TARGET_MEMORY ? "memory" : "null", total / frames,
+    frames / (total / 1000000.0), static_cast<double>(bytes) / frames,
+    target != RConsole::TARGET_MEMORY ? "-" : isRepeatable ? "yes" : "NO");
+}
+
+/// <summary>
+/// Times the raster diff kernels over a whole screen, which is the most a frame can ever
+/// scan, with a sparse scattering of glyphs that come, go, and stay. Every kernel has to
+/// find exactly the runs the scalar one does.
+/// </summary>
+/// <param name="width"></param>
+/// <param name="height"></param>
+void BenchRasterDiff(unsigned int width, unsigned int height)
+{
+  const unsigned int cells = width * height;
+  std::vector<RConsole::RasterInfo> curr(cells), prev(cells);
+  for (unsigned int i = 0; i < cells; ++i)
+  {
+    const int roll = rand() % 100;
+    RConsole::RasterInfo glyph('*', static_cast<RConsole::Color>(rand() % 15));
+    if (roll < 3)
+    {
+      prev[i] = glyph;
+    }
+    if (roll < 2 || (roll >= 3 && roll < 5))
+    {
+      glyph.SetModified(true);
+      curr[i] = glyph;
+    }
+  }
+
+  std::vector<RConsole::CellRun> runs(((width + 1) / 2) * height);
+  std::vector<RConsole::CellRun> expected;
+  const CpuFeatures::SimdLevel levels[] = { CpuFeatures::SIMD_SCALAR, CpuFeatures::SIMD_SSE2, CpuFeatures::SIMD_AVX2 };
+  const size_t scans = 200000000 / cells;
+  for (CpuFeatures::SimdLevel level : levels)
+  {
+    if (level > CpuFeatures::GetSimdLevel())
+    {
+      continue;
+    }
+
+    RConsole::RasterDiff::FindChangesFunc findChanges = RConsole::RasterDiff::GetFindChanges(level);
+    size_t count = 0;
+    BenchClock::time_point start = BenchClock::now();
+    for (size_t i = 0; i < scans; ++i)
+    {
+      count = 0;
+      for (unsigned int row = 0; row < height; ++row)
+      {
+        count += findChanges(curr.data(), prev.data(), row * width, (row + 1) * width, runs.data() + count);
+      }
+    }
+    const double total = MicrosecondsSince(start);
+
+    printf("raster_diff        size=%ux%-5u simd=%-7s us/scan=%.3f runs=%zu\n", width, height, CpuFeatures::GetSimdLevelName(level), total / scans, count);
+    if (level == CpuFeatures::SIMD_SCALAR)
+    {
+      expected.assign(runs.begin(), runs.begin() + count);
+    }
+    else if (count != expected.size() || memcmp(expected.data(), runs.data(), count * sizeof(RConsole::CellRun)) != 0)
+    {
+      printf("FAIL: %s raster diff disagrees with scalar\n", CpuFeatures::GetSimdLevelName(level));
+      ++benchFailures;
+    }
+  }
+}
+
+/// <summary>
+/// End-of-frame raster handoff at a given terminal size, with a fire's worth of glyphs drawn
+/// each frame. Compares copying the whole back buffer to the front and zeroing it, which is
+/// what a single pair of buffers costs, against swapping the pair and clearing only the
+/// spans that were drawn.
+/// </summary>
+/// <param name="width"></param>
+/// <param name="height"></param>
+void BenchRasterSwap(unsigned int width, unsigned int height)
+{
+  const size_t frames = 2000;
+  const unsigned int glyphs = 100;
+  std::vector<float> xs(glyphs), ys(glyphs);
+  for (unsigned int i = 0; i < glyphs; ++i)
+  {
+    xs[i] = static_cast<float>(width / 2 - 20 + rand() % 40);
+    ys[i] = static_cast<float>(height - 15 + rand() % 15);
+  }
+
+  // Full copy and clear of plain buffers of the same size.
+  std::vector<RConsole::RasterInfo> back(width * height), front(width * height);
+  BenchClock::time_point start = BenchClock::now();
+  for (size_t i = 0; i < frames; ++i)
+  {
+    for (unsigned int g = 0; g < glyphs; ++g)
+    {
+      back[static_cast<unsigned int>(xs[g]) + static_cast<unsigned int>(ys[g]) * width] = RConsole::RasterInfo('*', RConsole::RED);
+    }
+    memcpy(front.data(), back.data(), back.size() * sizeof(RConsole::RasterInfo));
+    memset(static_cast<void *>(back.data()), 0, back.size() * sizeof(RConsole::RasterInfo));
+  }
+  const double copyTime = MicrosecondsSince(start);
+
+  // Swap and span-limited clear.
+  RConsole::CanvasRaster r(width, height), prev(width, height);
+  r.Zero();
+  prev.Zero();
+  start = BenchClock::now();
+  for (size_t i = 0; i < frames; ++i)
+  {
+    for (unsigned int g = 0; g < glyphs; ++g)
+    {
+      r.WriteChar('*', xs[g], ys[g], RConsole::RED);
+    }
+    r.Swap(prev);
+    r.Zero();
+  }
+  const double swapTime = MicrosecondsSince(start);
+
+  printf("raster_swap        size=%ux%-5u copy us/frame=%.3f  swap us/frame=%.3f\n", width, height, copyTime / frames, swapTime / frames);
+}
+
+/// <summary>
+/// Times Canvas::Update from the simulation's side while stdout is a nearly full pipe that
+/// is drained slowly, like a terminal that can't keep up. Without the render thread each
+/// Update waits on the write; with it, Update only hands the frame off.
+/// </summary>
+/// <param name="pipelined">whether to run with the render thread</param>
+void BenchRenderStall(bool pipelined)
+{
+  const double dt = 0.004;
+  const size_t frames = 300;
+  RConsole::Canvas::ReInit(80, 25);
+  RConsole::Canvas::SetOutputMode(RConsole::OUTPUT_BUFFERED);
+  RConsole::Canvas::SetOutputMinimized(true);
+  ParticleSystem<BenchData> system(100, 0.015, true, BenchData(), BenchCreateFlameParticle, nullptr);
+  system.SetSeed(7);
+  system.SetAcceleration(0, -5);
+  system.SetPos(40, 22);
+
+  // A small pipe read at about 64KB/s stands in for the slow terminal.
+  int fds[2];
+  if (pipe(fds) != 0)
+  {
+    return;
+  }
+#ifdef F_SETPIPE_SZ
+  fcntl(fds[1], F_SETPIPE_SZ, 4096);
+#endif
+  fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+  std::atomic<bool> draining(true);
+  std::thread drainer([&]()
+  {
+    char sink[64];
+    while (draining)
+    {
+      if (read(fds[0], sink, sizeof(sink)) < 0)
+      {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        continue;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  });
+
+  fflush(stdout);
+  const int saved = dup(STDOUT_FILENO);
+  dup2(fds[1], STDOUT_FILENO);
+  if (pipelined)
+  {
+    RConsole::Canvas::StartRenderThread();
+  }
+
+  double total = 0;
+  double worst = 0;
+  for (size_t i = 0; i < frames; ++i)
+  {
+    system.Update(dt);
+    BenchDrawParticles(system);
+    BenchClock::time_point start = BenchClock::now();
+    RConsole::Canvas::Update();
+    const double elapsed = MicrosecondsSince(start);
+    total += elapsed;
+    worst = elapsed > worst ? elapsed : worst;
+  }
+
+  RConsole::Canvas::StopRenderThread();
+  RestoreStdout(saved);
+  draining = false;
+  drainer.join();
+  close(fds[0]);
+  close(fds[1]);
+
+  printf("render_stall       mode=%-9s update us avg=%.3f max=%.3f\n", pipelined ? "pipelined" : "inline", total / frames, worst);
+}
+
+/// <summary>
+/// Checks Field2D::Resize keeps the overlap and zeroes the rest, through a shrink, an
+/// in-place grow, and a grow that has to reallocate.
+/// </summary>
+void BenchFieldResize()
+{
+  const unsigned int sizes[][2] = { { 30, 20 }, { 17, 23 }, { 30, 9 }, { 41, 12 }, { 60, 40 } };
+  RConsole::Field2D<unsigned int> field(30, 20);
+  for (unsigned int y = 0; y < 20; ++y)
+  {
+    for (unsigned int x = 0; x < 30; ++x)
+    {
+      field.Get(x, y) = 1 + x + y * 1000;
+    }
+  }
+
+  unsigned int keepW = 30;
+  unsigned int keepH = 20;
+  for (const unsigned int *size : sizes)
+  {
+    field.Resize(size[0], size[1]);
+    keepW = size[0] < keepW ? size[0] : keepW;
+    keepH = size[1] < keepH ? size[1] : keepH;
+    for (unsigned int y = 0; y < size[1]; ++y)
+    {
+      for (unsigned int x = 0; x < size[0]; ++x)
+      {
+        const unsigned int expected = (x < keepW && y < keepH) ? 1 + x + y * 1000 : 0;
+        if (field.Peek(x, y) != expected)
+        {
+          printf("FAIL: field resize to %ux%u lost (%u, %u)\n", size[0], size[1], x, y);
+          ++benchFailures;
+          return;
+        }
+      }
+    }
+  }
+}
+
+/// <summary>
+/// Drags the window edge: a run of one-cell resizes between 200x60 and 240x67 with a fire
+/// drawn every frame, either by starting over (ReInit and a cls, the old way) or by resizing
+/// the canvas in place. Measures the resize plus the two frames after it, the bytes those
+/// write (counting the cls), and how many allocations it all takes. Two frames, because
+/// starting over throws away what was drawn and only shows the fire again a frame later.
+/// </summary>
+/// <param name="incremental">resize in place rather than start over</param>
+void BenchResize(bool incremental)
+{
+  const double dt = 0.004;
+  const size_t events = 80;
+  RConsole::Canvas::ReInit(200, 60);
+  RConsole::Canvas::SetOutputMode(RConsole::OUTPUT_BUFFERED);
+  RConsole::Canvas::SetOutputMinimized(true);
+  ParticleSystem<BenchData> system(100, 0.015, true, BenchData(), BenchCreateFlameParticle, nullptr);
+  system.SetSeed(7);
+  system.SetAcceleration(0, -5);
+  system.SetPos(100, 57);
+  const int saved = SilenceStdout();
+  for (size_t i = 0; i < 500; ++i)
+  {
+    system.Update(dt);
+    BenchDrawParticles(system);
+    RConsole::Canvas::Update();
+  }
+
+  double total = 0;
+  size_t bytes = 0;
+  const size_t before = allocationCount;
+  for (size_t i = 0; i < events; ++i)
+  {
+    const unsigned int step = static_cast<unsigned int>(i < events / 2 ? i : events - i);
+    const unsigned int width = 200 + step;
+    const unsigned int height = 60 + step / 6;
+
+    system.Update(dt);
+    BenchDrawParticles(system);
+    BenchClock::time_point start = BenchClock::now();
+    if (incremental)
+    {
+      RConsole::Canvas::Resize(width, height);
+    }
+    else
+    {
+      RConsole::Canvas::ReInit(width, height);
+      RConsole::Canvas::ForceClearEverything();
+      bytes += strlen("\033[2J\033[H");
+    }
+    RConsole::Canvas::Update();
+    bytes += RConsole::Canvas::GetLastFrameBytes();
+    system.Update(dt);
+    BenchDrawParticles(system);
+    RConsole::Canvas::Update();
+    bytes += RConsole::Canvas::GetLastFrameBytes();
+    total += MicrosecondsSince(start);
+  }
+  const size_t allocations = allocationCount - before;
+  RestoreStdout(saved);
+
+  printf("resize             mode=%-11s us/resize=%-9.3f bytes/resize=%-8.1f allocations=%zu\n",
+    incremental ? "incremental" : "reinit", total / events, static_cast<double>(bytes) / events, allocations);
+}
+
+/// <summary>
+/// Draws the scenery for BenchStaticLayers: a wall of text over the top two thirds, which
+/// goes behind everything, and a bar across the fire in front of it.
+/// </summary>
+/// <param name="width"></param>
+/// <param name="height"></param>
+/// <param name="isFront">draw the bar rather than the wall</param>
+void BenchDrawScenery(unsigned int width, unsigned int height, bool isFront)
+{
+  if (isFront)
+  {
+    RConsole::Canvas::DrawString(std::string(20, '='), static_cast<int>(width / 2 - 10), static_cast<int>(height - 6), RConsole::BROWN);
+    return;
+  }
+
+  const std::string row(width - 2, '#');
+  for (unsigned int y = 0; y < height * 2 / 3; y += 2)
+  {
+    RConsole::Canvas::DrawString(row, 1, static_cast<int>(y), static_cast<RConsole::Color>(1 + y % 14));
+  }
+}
+
+/// <summary>
+/// A mostly static scene with a fire going: scenery redrawn into the canvas every frame,
+/// against the same scenery drawn once into the static layers. Counts how many cells the
+/// diff has to look at a frame, and times the frame. Both have to write the same bytes.
+/// </summary>
+void BenchStaticLayers()
+{
+  const double dt = 0.004;
+  const size_t frames = 2000;
+  const unsigned int width = 240;
+  const unsigned int height = 67;
+  std::vector<char> captures[2];
+
+  for (int run = 0; run < 2; ++run)
+  {
+    const bool isStatic = run == 1;
+    RConsole::Canvas::SetOutputTarget(RConsole::TARGET_MEMORY);
+    RConsole::Canvas::SetOutputMinimized(true);
+    RConsole::Canvas::ReInit(width, height);
+    ParticleSystem<BenchData> system(100, 0.015, true, BenchData(), BenchCreateFlameParticle, nullptr);
+    system.SetSeed(7);
+    system.SetAcceleration(0, -5);
+    system.SetPos(width / 2.0, height - 3.0);
+
+    // A fresh canvas starts out full of spaces, which the layers would blank on the first
+    // frame. Get past it first, as Yule does.
+    RConsole::Canvas::Update();
+    RConsole::Canvas::ClearCapturedOutput();
+    if (isStatic)
+    {
+      RConsole::Canvas::SetLayer(RConsole::LAYER_BACK);
+      BenchDrawScenery(width, height, false);
+      RConsole::Canvas::SetLayer(RConsole::LAYER_FRONT);
+      BenchDrawScenery(width, height, true);
+      RConsole::Canvas::SetLayer(RConsole::LAYER_DYNAMIC);
+    }
+
+    double total = 0;
+    size_t scanned = 0;
+    for (size_t i = 0; i < frames; ++i)
+    {
+      system.Update(dt);
+      BenchClock::time_point start = BenchClock::now();
+      if (!isStatic)
+      {
+        BenchDrawScenery(width, height, false);
+      }
+      BenchDrawParticles(system);
+      if (!isStatic)
+      {
+        BenchDrawScenery(width, height, true);
+      }
+      RConsole::Canvas::Update();
+      total += MicrosecondsSince(start);
+      scanned += RConsole::Canvas::GetLastFrameScanned();
+    }
+
+    captures[run] = RConsole::Canvas::GetCapturedOutput();
+    RConsole::Canvas::ClearCapturedOutput();
+    if (isStatic)
+    {
+      RConsole::Canvas::ClearLayer(RConsole::LAYER_BACK);
+      RConsole::Canvas::ClearLayer(RConsole::LAYER_FRONT);
+    }
+
+    printf("static_layers      scenery=%-8s us/frame=%-9.3f cells_diffed/frame=%.1f\n",
+      isStatic ? "layered" : "redrawn", total / frames, static_cast<double>(scanned) / frames);
+  }
+
+  RConsole::Canvas::SetOutputTarget(RConsole::TARGET_TERMINAL);
+  if (captures[0] != captures[1])
+  {
+    printf("FAIL: static layers wrote a different frame than redrawing the scenery\n");
+    ++benchFailures;
+  }
+}
+
+/// <summary>
+/// Drives the frame pacer from a fake clock: 30hz frames with a 200ms hitch every 50th,
+/// then a stretch where every frame is behind followed by a clean one. Checks the fixed
+/// steps add up to the banked time and that the render rate backs off and recovers.
+/// Finishes with a real second of pacing to count wakeups, both drawing and idle.
+/// </summary>
+void BenchFramePacer()
+{
+  const double simHz = 120;
+  FramePacer pacer(simHz, 30);
+  FramePacer::Clock::time_point now = FramePacer::Clock::now();
+  pacer.BeginFrame(now);
+
+  const size_t frames = 1000;
+  double banked = pacer.GetInterpolation(); // Whatever passed between constructing and the first frame
+  size_t steps = 0;
+  size_t worstSteps = 0;
+  for (size_t i = 0; i < frames; ++i)
+  {
+    const FramePacer::Clock::duration elapsed = std::chrono::duration_cast<FramePacer::Clock::duration>(
+      std::chrono::duration<double>(i % 50 == 49 ? 0.2 : 1.0 / 30));
+    now += elapsed;
+    banked += std::chrono::duration<double>(elapsed).count();
+    pacer.BeginFrame(now);
+
+    size_t frameSteps = 0;
+    while (pacer.StepSimulation())
+    {
+      ++frameSteps;
+    }
+    steps += frameSteps;
+    worstSteps = frameSteps > worstSteps ? frameSteps : worstSteps;
+  }
+
+  const double simulated = steps * pacer.GetStep() + pacer.GetInterpolation();
+  printf("pacer_steps        frames=%-8zu steps=%-7zu worst/frame=%-3zu drift=%.9fs\n", frames, steps, worstSteps, simulated - banked);
+  if (simulated - banked > 1e-6 || banked - simulated > 1e-6 || pacer.GetInterpolation() >= pacer.GetStep())
+  {
+    printf("FAIL: fixed steps don't add up to the time banked\n");
+    ++benchFailures;
+  }
+
+  for (size_t i = 0; i < FramePacer::WindowFrames * 20; ++i)
+  {
+    pacer.ReportFrame(true);
+  }
+  const double backedOff = pacer.GetRenderHz();
+  for (size_t i = 0; i < FramePacer::WindowFrames * 100; ++i)
+  {
+    pacer.ReportFrame(false);
+  }
+  const double recovered = pacer.GetRenderHz();
+  printf("pacer_adapt        target=%.1fhz behind=%.1fhz recovered=%.1fhz\n", pacer.GetTargetRenderHz(), backedOff, recovered);
+  if (backedOff != FramePacer::MinRenderHz || recovered != pacer.GetTargetRenderHz())
+  {
+    printf("FAIL: render rate didn't back off and recover\n");
+    ++benchFailures;
+  }
+
+  for (int idle = 0; idle < 2; ++idle)
+  {
+    size_t wakeups = 0;
+    FramePacer realPacer(simHz, 30);
+    realPacer.SetOutputVisible(idle == 0);
+    BenchClock::time_point start = BenchClock::now();
+    while (MicrosecondsSince(start) < 1000000)
+    {
+      realPacer.BeginFrame();
+      realPacer.EndFrame(false);
+      ++wakeups;
+    }
+    printf("pacer_wakeups      render=30hz %-8s wakeups/s=%zu\n", idle ? "idle" : "drawing", wakeups);
+  }
+}
+
+/// <summary>
+/// Runs every benchmark in sequence.
+/// </summary>
+/// <returns></returns>
+int main()
+{
+  srand(1);
+
+  BenchParticleUpdate(100);
+  BenchParticleUpdate(10000);
+  BenchParticleUpdate(1000000);
+
+  BenchIntegrateKernels(10000);
+  BenchIntegrateKernels(50000);
+
+  BenchUpdatePolicies(10000);
+  BenchUpdatePolicies(100000);
+
+  BenchParallelUpdate(16384);
+  BenchParallelUpdate(65536);
+  BenchParallelUpdate(1000000);
+
+  BenchRandom(1000000);
+
+  BenchSteadyStateAllocations();
+  BenchDrawAllocations();
+  BenchSprite();
+  BenchDrawPoints(100000);
+
+  BenchFrameEmission(RConsole::OUTPUT_DIRECT, false, 80, 25);
+  BenchFrameEmission(RConsole::OUTPUT_BUFFERED, false, 80, 25);
+  BenchFrameEmission(RConsole::OUTPUT_BUFFERED, true, 80, 25);
+  BenchFrameEmission(RConsole::OUTPUT_BUFFERED, true, 240, 67);
+  BenchFrameEmission(RConsole::OUTPUT_BUFFERED, true, 500, 150);
+
+  BenchHeadless(RConsole::TARGET_MEMORY, 80, 25);
+  BenchHeadless(RConsole::TARGET_FILE, 80, 25);
+  BenchHeadless(RConsole::TARGET_MEMORY, 240, 67);
+
+  BenchRasterDiff(80, 25);
+  BenchRasterDiff(240, 67);
+  BenchRasterDiff(500, 150);
+
+  BenchRasterSwap(80, 25);
+  BenchRasterSwap(240, 67);
+  BenchRasterSwap(500, 150);
+  BenchRasterSwap(1000, 300);
+
+  BenchRenderStall(false);
+  BenchRenderStall(true);
+
+  BenchFramePacer();
+
+  BenchFieldResize();
+  BenchResize(false);
+  BenchResize(true);
+
+  BenchStaticLayers();
+
+  return benchFailures;
+}
@@ -0,0 +1 @@
+#include "FramePacer.hpp"
\ No newline at end of file
@@ -0,0 +1,342 @@
+#pragma once
+#include <chrono>
+#include <thread>
+
+#if defined(_WIN32)
+#include <io.h>     // _isatty
+#include <cstdio>   // _fileno
+#else
+#include <poll.h>   // Waiting on input, resizes, and the frame deadline at once
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+
+/// <summary>
+/// Runs the main loop at two separate rates. The simulation advances in fixed steps of 1/simHz:
+/// real time goes into an accumulator and is paid back out as whole steps, so a frame hitch turns
+/// into a few extra steps rather than one big dt. Frames are drawn at up to renderHz, and the
+/// leftover time smaller than a step is handed to drawing so positions can be carried forward.
+/// The render rate adapts: when output keeps falling behind it backs off, and once frames have
+/// been on time for a while it climbs back toward the target.
+/// Between frames the process sleeps in a single poll on stdin, a resize handle (see WakeOn),
+/// and the frame deadline, so a keypress or resize is handled right away no matter how slow the
+/// frame rate is. When the screen has stopped changing, or output isn't going to a terminal
+/// at all, it idles along at IdleHz.
+/// </summary>
+class FramePacer
+{
+public:
+  typedef std::chrono::steady_clock Clock;
+
+  FramePacer(double simHz, double renderHz)
+    : simHz_(simHz > 0 ? simHz : 1)
+    , step_(1.0 / simHz_)
+    , targetRenderHz_(renderHz > MinRenderHz ? renderHz : MinRenderHz)
+    , renderHz_(targetRenderHz_)
+    , accumulator_(0)
+    , frameStart_(Clock::now())
+    , nextFrame_(frameStart_)
+    , frameMicroseconds_(0)
+    , windowFrames_(0)
+    , windowBehind_(0)
+    , stableWindows_(0)
+    , stillFrames_(0)
+    , isOutputVisible_(IsOutputTerminal())
+    , isWatchingInput_(IsInputTerminal())
+    , wakeups_(0)
+    , wakeupWindowStart_(frameStart_)
+    , wakeupsPerSecond_(0)
+    , wakeHandle_(-1)
+  {  }
+
+  /// <summary>
+  /// Starts a frame, banking the real time since the last one. Anything past MaxFrameSeconds
+  /// is thrown away so a long stall (a debugger, a suspended laptop) can't queue up a
+  /// burst of catch-up steps.
+  /// </summary>
+  void BeginFrame()
+  {
+    BeginFrame(Clock::now());
+  }
+
+  /// <summary>
+  /// Starts a frame at the specified time. Lets callers drive the pacer from their own clock.
+  /// </summary>
+  /// <param name="now">when this frame started</param>
+  void BeginFrame(Clock::time_point now)
+  {
+    double elapsed = std::chrono::duration<double>(now - frameStart_).count();
+    frameMicroseconds_ = static_cast<long>(elapsed * 1000000.0);
+    frameStart_ = now;
+
+    if (elapsed > MaxFrameSeconds)
+    {
+      elapsed = MaxFrameSeconds;
+    }
+    accumulator_ += elapsed;
+  }
+
+  /// <summary>
+  /// Starts over from the specified time with nothing banked. A caller driving the pacer
+  /// from its own clock uses this to line that clock up, so every frame banks exactly
+  /// what the caller says it did.
+  /// </summary>
+  /// <param name="now">the time the first frame is measured from</param>
+  void Restart(Clock::time_point now)
+  {
+    accumulator_ = 0;
+    frameStart_ = now;
+    nextFrame_ = now;
+  }
+
+  /// <summary>
+  /// Takes one fixed step out of the accumulator if a whole one is banked. Loop on this,
+  /// advancing the simulation by GetStep() each time it returns true.
+  /// </summary>
+  /// <returns>true if the simulation should advance one step</returns>
+  bool StepSimulation()
+  {
+    if (accumulator_ < step_)
+    {
+      return false;
+    }
+
+    accumulator_ -= step_;
+    return true;
+  }
+
+  /// <summary>
+  /// Ends a frame: feeds how it went into the render rate, then sleeps until the next
+  /// frame is due or input or a resize shows up. A frame counts as behind if its own work
+  /// ran past the frame period, or if the caller saw output drop it.
+  /// </summary>
+  /// <param name="outputDropped">true if the output side discarded a frame since the last call</param>
+  /// <param name="outputChanged">false if the frame left the screen exactly as it was</param>
+  void EndFrame(bool outputDropped, bool outputChanged = true)
+  {
+    const Clock::time_point now = Clock::now();
+    ReportFrame(outputDropped || now - frameStart_ > GetRenderPeriod());
+    stillFrames_ = outputChanged ? 0 : stillFrames_ + 1;
+
+    // Aim for a frame every period, but never try to catch up on frames already missed.
+    nextFrame_ += GetFramePeriod();
+    if (nextFrame_ < now)
+    {
+      nextFrame_ = now;
+    }
+
+    // Woken early by an event, so the next frame is a full period after this one.
+    if (waitUntil(nextFrame_))
+    {
+      nextFrame_ = Clock::now();
+    }
+
+    countWakeup();
+  }
+
+  /// <summary>
+  /// Counts a frame toward the current adaptation window. At the end of each window, the
+  /// render rate drops if too many frames were behind, and rises again after a few clean windows.
+  /// </summary>
+  /// <param name="wasBehind">if this frame didn't make it out in time</param>
+  void ReportFrame(bool wasBehind)
+  {
+    ++windowFrames_;
+    if (wasBehind)
+    {
+      ++windowBehind_;
+    }
+
+    if (windowFrames_ < WindowFrames)
+    {
+      return;
+    }
+
+    if (windowBehind_ * BehindDivisor > windowFrames_)
+    {
+      renderHz_ *= BackoffScale;
+      if (renderHz_ < MinRenderHz)
+      {
+        renderHz_ = MinRenderHz;
+      }
+      stableWindows_ = 0;
+    }
+    else if (windowBehind_ == 0 && ++stableWindows_ >= RecoverWindows)
+    {
+      renderHz_ *= RecoverScale;
+      if (renderHz_ > targetRenderHz_)
+      {
+        renderHz_ = targetRenderHz_;
+      }
+      stableWindows_ = 0;
+    }
+
+    windowFrames_ = 0;
+    windowBehind_ = 0;
+  }
+
+  // Seconds of banked time not yet simulated. Always less than a step once StepSimulation
+  // returns false; draw code can move things along their velocity by this much.
+  double GetInterpolation() const { return accumulator_; }
+
+  // If frames are currently paced at IdleHz rather than the render rate.
+  bool IsIdle() const { return !isOutputVisible_ || stillFrames_ >= StillFrames; }
+
+  // Accessors
+  double GetStep() const              { return step_; }
+  double GetSimHz() const             { return simHz_; }
+  double GetRenderHz() const          { return renderHz_; }
+  double GetTargetRenderHz() const    { return targetRenderHz_; }
+  long GetFrameMicroseconds() const   { return frameMicroseconds_; }
+  double GetWakeupsPerSecond() const  { return wakeupsPerSecond_; }
+
+  Clock::duration GetRenderPeriod() const
+  {
+    return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / renderHz_));
+  }
+
+  // Time between frames right now, which is longer than the render period while idle.
+  Clock::duration GetFramePeriod() const
+  {
+    double hz = renderHz_;
+    if (IsIdle() && hz > IdleHz)
+    {
+      hz = IdleHz;
+    }
+    return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / hz));
+  }
+
+  // Also wakes up early whenever this descriptor is readable. Its owner has to drain it
+  // during the frame, or every wait returns straight away. -1 for none.
+  void WakeOn(int handle) { wakeHandle_ = handle; }
+
+  // Overrides whether anyone can see the output, which otherwise comes from stdout being a terminal.
+  void SetOutputVisible(bool isVisible) { isOutputVisible_ = isVisible; }
+
+  // If stdout is a terminal. Output going anywhere else has nobody watching it.
+  static bool IsOutputTerminal()
+  {
+  #if defined(_WIN32)
+    return _isatty(_fileno(stdout)) != 0;
+  #else
+    return isatty(STDOUT_FILENO) != 0;
+  #endif
+  }
+
+  // If stdin is a terminal, and so worth waking up for. Anything else (a file, /dev/null)
+  // may read as ready forever without anyone typing.
+  static bool IsInputTerminal()
+  {
+  #if defined(_WIN32)
+    return _isatty(_fileno(stdin)) != 0;
+  #else
+    return isatty(STDIN_FILENO) != 0;
+  #endif
+  }
+
+  // Tuning
+  static constexpr double MaxFrameSeconds = 0.25; // Most real time a single frame can bank
+  static constexpr double MinRenderHz = 2.0;      // Render rate floor when backing off
+  static constexpr double BackoffScale = 0.75;    // Render rate multiplier when behind
+  static constexpr double RecoverScale = 1.1;     // Render rate multiplier when recovering
+  static const unsigned int WindowFrames = 30;    // Frames per adaptation window
+  static const unsigned int BehindDivisor = 10;   // More than 1 in this many frames behind backs off
+  static const unsigned int RecoverWindows = 2;   // Clean windows in a row before recovering
+  static constexpr double IdleHz = 4.0;           // Frame rate while idle
+  static const unsigned int StillFrames = 30;     // Unchanged frames in a row before idling
+
+private:
+  /// <summary>
+  /// Blocks until the deadline, or until there's input or the terminal was resized.
+  /// Windows console input handles stay signaled for events _kbhit ignores (focus, mouse),
+  /// so waiting on one could spin; there it's a plain sleep.
+  /// </summary>
+  /// <param name="deadline">when to wake up if nothing happens first</param>
+  /// <returns>true if woken early by input or a resize</returns>
+  bool waitUntil(Clock::time_point deadline)
+  {
+  #if defined(_WIN32)
+    std::this_thread::sleep_until(deadline);
+    return false;
+  #else
+    const Clock::duration remaining = deadline - Clock::now();
+    if (remaining <= Clock::duration::zero())
+    {
+      return false;
+    }
+
+    // Round up, so a timeout never lands just short of the deadline.
+    const long long micro = std::chrono::duration_cast<std::chrono::microseconds>(remaining).count();
+    const int timeoutMs = static_cast<int>((micro + 999) / 1000);
+
+    struct pollfd fds[2];
+    nfds_t count = 0;
+    if (wakeHandle_ >= 0)
+    {
+      fds[count].fd = wakeHandle_;
+      fds[count].events = POLLIN;
+      fds[count].revents = 0;
+      ++count;
+    }
+    if (isWatchingInput_)
+    {
+      fds[count].fd = STDIN_FILENO;
+      fds[count].events = POLLIN;
+      fds[count].revents = 0;
+      ++count;
+    }
+
+    // A signal (like the SIGWINCH behind a resize) interrupts the poll, which counts as a wakeup.
+    const int ready = poll(fds, count, timeoutMs);
+    if (ready <= 0)
+    {
+      return ready < 0 && errno == EINTR;
+    }
+
+    for (nfds_t i = 0; i < count; ++i)
+    {
+      if (fds[i].fd == STDIN_FILENO && (fds[i].revents & (POLLHUP | POLLERR | POLLNVAL)))
+      {
+        isWatchingInput_ = false; // Closed input would wake every poll from here on.
+      }
+    }
+
+    return true;
+  #endif
+  }
+
+  // Counts a return from waiting, and turns the count into a rate about once a second.
+  void countWakeup()
+  {
+    ++wakeups_;
+    const Clock::time_point now = Clock::now();
+    const double elapsed = std::chrono::duration<double>(now - wakeupWindowStart_).count();
+    if (elapsed >= 1.0)
+    {
+      wakeupsPerSecond_ = wakeups_ / elapsed;
+      wakeups_ = 0;
+      wakeupWindowStart_ = now;
+    }
+  }
+
+  // Variables
+  double simHz_;
+  double step_;
+  double targetRenderHz_;
+  double renderHz_;
+  double accumulator_;            // Banked real time, in seconds
+  Clock::time_point frameStart_;
+  Clock::time_point nextFrame_;   // When the next frame is due to start
+  long frameMicroseconds_;        // Real time between the last two frames
+  unsigned int windowFrames_;
+  unsigned int windowBehind_;
+  unsigned int stableWindows_;
+  unsigned int stillFrames_;      // Frames in a row that didn't change the screen
+  bool isOutputVisible_;
+  bool isWatchingInput_;
+  unsigned int wakeups_;
+  Clock::time_point wakeupWindowStart_;
+  double wakeupsPerSecond_;
+  int wakeHandle_;                // Extra descriptor to wake on, -1 for none
+};
@@ -0,0 +1 @@
+#include "FrameProfiler.hpp"
\ No newline at end of file
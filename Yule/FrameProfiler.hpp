@@ -0,0 +1,173 @@
+#pragma once
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+
+/// <summary>
+/// Rolling timings for the stages of a frame. Each stage keeps its last WindowFrames samples,
+/// and reports the min, average, and 99th percentile over them. Stages are timed with a Scope
+/// around the work, or fed numbers measured elsewhere with Record.
+/// While disabled, a Scope is a single branch: the clock is never read and nothing is stored.
+/// Not thread safe; timings from another thread should be handed over and recorded here.
+/// </summary>
+class FrameProfiler
+{
+public:
+  typedef std::chrono::steady_clock Clock;
+
+  // Timings for a stage over the window, in microseconds.
+  struct Stats
+  {
+    long Min;
+    long Avg;
+    long P99;
+  };
+
+  /// <summary>
+  /// Times the stage from construction to destruction, if the profiler is enabled.
+  /// </summary>
+  class Scope
+  {
+  public:
+    Scope(FrameProfiler& profiler, size_t stage)
+      : profiler_(profiler.IsEnabled() ? &profiler : nullptr)
+      , stage_(stage)
+    {
+      if (profiler_)
+      {
+        start_ = Clock::now();
+      }
+    }
+
+    ~Scope()
+    {
+      if (profiler_)
+      {
+        profiler_->Record(stage_, std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start_).count());
+      }
+    }
+
+  private:
+    Scope(const Scope&);
+    Scope& operator=(const Scope&);
+
+    FrameProfiler* profiler_; // nullptr while disabled
+    size_t stage_;
+    Clock::time_point start_;
+  };
+
+  FrameProfiler()
+    : isEnabled_(false)
+  {  }
+
+  /// <summary>
+  /// Adds a stage to time. Stages are reported in the order they were added.
+  /// </summary>
+  /// <param name="name">shown next to the stage's timings</param>
+  /// <returns>the stage's id, for Scope and Record</returns>
+  size_t AddStage(const std::string& name)
+  {
+    stages_.push_back(Stage(name));
+    return stages_.size() - 1;
+  }
+
+  /// <summary>
+  /// Adds a sample to a stage, pushing out its oldest once the window is full.
+  /// Ignored while disabled, so numbers from before don't linger in the window.
+  /// </summary>
+  /// <param name="stage">id from AddStage</param>
+  /// <param name="microseconds">how long the stage took this frame</param>
+  void Record(size_t stage, long long microseconds)
+  {
+    if (!isEnabled_)
+    {
+      return;
+    }
+
+    Stage& s = stages_[stage];
+    s.Samples[s.Next] = static_cast<long>(microseconds);
+    s.Next = (s.Next + 1) % WindowFrames;
+    if (s.Count < WindowFrames)
+    {
+      ++s.Count;
+    }
+  }
+
+  /// <summary>
+  /// Min, average, and 99th percentile of the stage's window. All zero if it has no samples.
+  /// </summary>
+  /// <param name="stage">id from AddStage</param>
+  /// <returns>timings in microseconds</returns>
+  Stats GetStats(size_t stage) const
+  {
+    const Stage& s = stages_[stage];
+    Stats stats = { 0, 0, 0 };
+    if (s.Count == 0)
+    {
+      return stats;
+    }
+
+    sorted_.assign(s.Samples.begin(), s.Samples.begin() + s.Count);
+    std::sort(sorted_.begin(), sorted_.end());
+
+    long long total = 0;
+    for (long sample : sorted_)
+    {
+      total += sample;
+    }
+
+    stats.Min = sorted_.front();
+    stats.Avg = static_cast<long>(total / static_cast<long long>(s.Count));
+    stats.P99 = sorted_[(s.Count * 99 - 1) / 100];
+    return stats;
+  }
+
+  /// <summary>
+  /// Turns timing on or off. Turning it on starts every stage over with an empty window.
+  /// </summary>
+  /// <param name="isEnabled"></param>
+  void SetEnabled(bool isEnabled)
+  {
+    if (isEnabled && !isEnabled_)
+    {
+      for (Stage& s : stages_)
+      {
+        s.Next = 0;
+        s.Count = 0;
+      }
+    }
+    isEnabled_ = isEnabled;
+  }
+
+  // Accessors
+  bool IsEnabled() const                              { return isEnabled_; }
+  size_t GetStageCount() const                        { return stages_.size(); }
+  const std::string& GetStageName(size_t stage) const { return stages_[stage].Name; }
+
+  // Tuning
+  static const size_t WindowFrames = 120; // Samples kept per stage
+
+private:
+  // A stage's name and its ring of recent samples.
+  struct Stage
+  {
+    std::string Name;
+    std::vector<long> Samples;
+    size_t Next;  // Where the next sample goes
+    size_t Count; // Samples in the window, up to WindowFrames
+
+    explicit Stage(const std::string& name)
+      : Name(name)
+      , Samples(WindowFrames, 0)
+      , Next(0)
+      , Count(0)
+    {  }
+  };
+
+  // Variables
+  bool isEnabled_;
+  std::vector<Stage> stages_;
+  mutable std::vector<long> sorted_; // Scratch for GetStats, kept to avoid allocating every frame
+};
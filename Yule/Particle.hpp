@@ -26,3 +26,59 @@ public:
 };
 
 
+
+
+/// <summary>
+/// A particle that lives inside of a ParticleStorage. Rather than owning its values, each
+/// member refers back into the storage arrays, so edits made through it stick.
+/// </summary>
+template <typename T> class ParticleRef
+{
+public:
+  ParticleRef(T &d, double &x, double &y, double &vx, double &vy, double &life)
+    : Data(d)
+    , PosX(x)
+    , PosY(y)
+    , VelX(vx)
+    , VelY(vy)
+    , Life(life)
+  {  }
+
+  // Snapshot of the referenced values as a standalone particle.
+  operator Particle<T>() const { return Particle<T>(Data, PosX, PosY, VelX, VelY, Life); }
+
+  T &Data;
+  double &PosX;
+  double &PosY;
+  double &VelX;
+  double &VelY;
+  double &Life;
+};
+
+
+/// <summary>
+/// Read-only counterpart to ParticleRef, for looking at particles without being able to
+/// change them (or paying to copy them).
+/// </summary>
+template <typename T> class ConstParticleRef
+{
+public:
+  ConstParticleRef(const T &d, const double &x, const double &y, const double &vx, const double &vy, const double &life)
+    : Data(d)
+    , PosX(x)
+    , PosY(y)
+    , VelX(vx)
+    , VelY(vy)
+    , Life(life)
+  {  }
+
+  // Snapshot of the referenced values as a standalone particle.
+  operator Particle<T>() const { return Particle<T>(Data, PosX, PosY, VelX, VelY, Life); }
+
+  const T &Data;
+  const double &PosX;
+  const double &PosY;
+  const double &VelX;
+  const double &VelY;
+  const double &Life;
+};
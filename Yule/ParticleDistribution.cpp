@@ -0,0 +1 @@
+#include "ParticleDistribution.hpp"
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "ParticleRandom.hpp"
+
+
+/// <summary>
+/// A random distribution baked into a table, so drawing from it is a lookup rather than the
+/// math that shapes it. The shape is a function taking a number uniform in [0, 1) to a sample,
+/// like the curve particle lifetimes follow; it's run once per slot, at the middle of the
+/// slot's share of [0, 1), and never again. Samples only take as many distinct values as there
+/// are slots, which is plenty for anything drawn once per spawned particle.
+/// </summary>
+class ParticleDistribution
+{
+public:
+  /// <summary>
+  /// Builds the table.
+  /// </summary>
+  /// <param name="shape">callable as double(double uniform)</param>
+  /// <param name="bits">log2 of the number of slots, 1 to 24</param>
+  template <typename Shape> explicit ParticleDistribution(Shape shape, unsigned int bits = DefaultBits)
+    : table_(static_cast<size_t>(1) << bits)
+    , shift_(64 - bits)
+  {
+    for (size_t i = 0; i < table_.size(); ++i)
+    {
+      table_[i] = shape((i + 0.5) / table_.size());
+    }
+  }
+
+  /// <summary>
+  /// One sample, picked with the top bits of the generator's next number.
+  /// </summary>
+  double Sample(ParticleRandom& random) const
+  {
+    return table_[random.Next() >> shift_];
+  }
+
+  // Accessors
+  size_t GetSize() const { return table_.size(); }
+
+  // Tuning
+  static const unsigned int DefaultBits = 12; // 4096 slots, 32KB
+
+private:
+  // Variables
+  std::vector<double> table_;
+  unsigned int shift_;
+};
@@ -0,0 +1 @@
+#include "ParticleKernels.hpp"
\ No newline at end of file
@@ -0,0 +1,153 @@
+#pragma once
+#include <cstddef>
+#include "cpu-features.hpp"
+
+#ifdef CPU_FEATURES_X86
+#include <emmintrin.h> // SSE2
+#include <immintrin.h> // AVX
+#endif
+
+// Lets a single function opt in to an instruction set without building the whole
+// project with it. MSVC allows the intrinsics anywhere, so it needs nothing.
+#if defined(__GNUC__) || defined(__clang__)
+#define PARTICLE_KERNEL_TARGET(isa) __attribute__((target(isa)))
+#else
+#define PARTICLE_KERNEL_TARGET(isa)
+#endif
+
+
+/// <summary>
+/// Batched particle integration over structure-of-arrays data. Every kernel does the same work:
+/// apply acceleration to velocity, age by dt, move along velocity, and write 1 into the kill
+/// mask for each particle whose life ran out (0 otherwise). Returns how many were killed.
+/// </summary>
+namespace ParticleKernels
+{
+  typedef size_t (*IntegrateFunc)(size_t count, double *posX, double *posY, double *velX, double *velY, double *life,
+                                  double dt, double accelX, double accelY, unsigned char *killMask);
+
+  /// <summary>
+  /// Plain loop, also used for the tail end of the wider kernels.
+  /// </summary>
+  inline size_t IntegrateScalar(size_t count, double *posX, double *posY, double *velX, double *velY, double *life,
+                                double dt, double accelX, double accelY, unsigned char *killMask)
+  {
+    const double dvX = accelX * dt;
+    const double dvY = accelY * dt;
+    size_t killed = 0;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+      velX[i] += dvX;
+      velY[i] += dvY;
+      life[i] -= dt;
+      posX[i] += velX[i] * dt;
+      posY[i] += velY[i] * dt;
+
+      const unsigned char dead = life[i] <= 0 ? 1 : 0;
+      killMask[i] = dead;
+      killed += dead;
+    }
+
+    return killed;
+  }
+
+#ifdef CPU_FEATURES_X86
+  /// <summary>
+  /// Two particles per step.
+  /// </summary>
+  PARTICLE_KERNEL_TARGET("sse2")
+  inline size_t IntegrateSSE2(size_t count, double *posX, double *posY, double *velX, double *velY, double *life,
+                              double dt, double accelX, double accelY, unsigned char *killMask)
+  {
+    const __m128d vdt = _mm_set1_pd(dt);
+    const __m128d vdvX = _mm_set1_pd(accelX * dt);
+    const __m128d vdvY = _mm_set1_pd(accelY * dt);
+    const __m128d zero = _mm_setzero_pd();
+    size_t killed = 0;
+    size_t i = 0;
+
+    for (; i + 2 <= count; i += 2)
+    {
+      const __m128d vx = _mm_add_pd(_mm_loadu_pd(velX + i), vdvX);
+      const __m128d vy = _mm_add_pd(_mm_loadu_pd(velY + i), vdvY);
+      const __m128d l = _mm_sub_pd(_mm_loadu_pd(life + i), vdt);
+      _mm_storeu_pd(velX + i, vx);
+      _mm_storeu_pd(velY + i, vy);
+      _mm_storeu_pd(life + i, l);
+      _mm_storeu_pd(posX + i, _mm_add_pd(_mm_loadu_pd(posX + i), _mm_mul_pd(vx, vdt)));
+      _mm_storeu_pd(posY + i, _mm_add_pd(_mm_loadu_pd(posY + i), _mm_mul_pd(vy, vdt)));
+
+      const int dead = _mm_movemask_pd(_mm_cmple_pd(l, zero));
+      killMask[i + 0] = static_cast<unsigned char>(dead & 1);
+      killMask[i + 1] = static_cast<unsigned char>((dead >> 1) & 1);
+      killed += (dead & 1) + ((dead >> 1) & 1);
+    }
+
+    return killed + IntegrateScalar(count - i, posX + i, posY + i, velX + i, velY + i, life + i, dt, accelX, accelY, killMask + i);
+  }
+
+  /// <summary>
+  /// Four particles per step.
+  /// </summary>
+  PARTICLE_KERNEL_TARGET("avx2")
+  inline size_t IntegrateAVX2(size_t count, double *posX, double *posY, double *velX, double *velY, double *life,
+                              double dt, double accelX, double accelY, unsigned char *killMask)
+  {
+    const __m256d vdt = _mm256_set1_pd(dt);
+    const __m256d vdvX = _mm256_set1_pd(accelX * dt);
+    const __m256d vdvY = _mm256_set1_pd(accelY * dt);
+    const __m256d zero = _mm256_setzero_pd();
+    size_t killed = 0;
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4)
+    {
+      const __m256d vx = _mm256_add_pd(_mm256_loadu_pd(velX + i), vdvX);
+      const __m256d vy = _mm256_add_pd(_mm256_loadu_pd(velY + i), vdvY);
+      const __m256d l = _mm256_sub_pd(_mm256_loadu_pd(life + i), vdt);
+      _mm256_storeu_pd(velX + i, vx);
+      _mm256_storeu_pd(velY + i, vy);
+      _mm256_storeu_pd(life + i, l);
+      _mm256_storeu_pd(posX + i, _mm256_add_pd(_mm256_loadu_pd(posX + i), _mm256_mul_pd(vx, vdt)));
+      _mm256_storeu_pd(posY + i, _mm256_add_pd(_mm256_loadu_pd(posY + i), _mm256_mul_pd(vy, vdt)));
+
+      const int dead = _mm256_movemask_pd(_mm256_cmp_pd(l, zero, _CMP_LE_OQ));
+      for (int lane = 0; lane < 4; ++lane)
+      {
+        const unsigned char laneDead = static_cast<unsigned char>((dead >> lane) & 1);
+        killMask[i + lane] = laneDead;
+        killed += laneDead;
+      }
+    }
+
+    return killed + IntegrateScalar(count - i, posX + i, posY + i, velX + i, velY + i, life + i, dt, accelX, accelY, killMask + i);
+  }
+#endif // CPU_FEATURES_X86
+
+  /// <summary>
+  /// Kernel for a specific SIMD level. Falls back to scalar if the level isn't compiled in.
+  /// </summary>
+  inline IntegrateFunc GetIntegrate(CpuFeatures::SimdLevel level)
+  {
+#ifdef CPU_FEATURES_X86
+    switch (level)
+    {
+      case CpuFeatures::SIMD_AVX2: return IntegrateAVX2;
+      case CpuFeatures::SIMD_SSE2: return IntegrateSSE2;
+      default: break;
+    }
+#endif
+    (void)level;
+    return IntegrateScalar;
+  }
+
+  /// <summary>
+  /// Widest kernel the running CPU supports, chosen once.
+  /// </summary>
+  inline IntegrateFunc GetIntegrate()
+  {
+    static const IntegrateFunc integrate = GetIntegrate(CpuFeatures::GetSimdLevel());
+    return integrate;
+  }
+}
@@ -0,0 +1 @@
+#include "ParticlePolicies.hpp"
\ No newline at end of file
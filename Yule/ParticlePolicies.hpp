@@ -0,0 +1,90 @@
+#pragma once
+#include <functional>
+#include "Particle.hpp"
+#include "ParticleRandom.hpp"
+
+// Spawn and update policies for ParticleSystem. A policy is any type callable as
+//   spawn:  void(Particle<T>&, ParticleRandom&) - once per new particle, with the system's generator
+//   update: void(double dt, ParticleRef<T>)     - once per live particle per frame
+// Plain functor policies are resolved at compile time and can be inlined into the update
+// loop. The Function* policies are the type-erased adapters behind the std::function
+// constructor, and accept anything std::function does (including nullptr for "none").
+
+
+/// <summary>
+/// Type-erased spawn policy backed by std::function.
+/// </summary>
+template <typename T> class FunctionSpawnPolicy
+{
+public:
+  FunctionSpawnPolicy()
+    : function_()
+  {  }
+
+  template <typename F> FunctionSpawnPolicy(F function)
+    : function_(function)
+  {  }
+
+  void operator()(Particle<T> &p, ParticleRandom &random) const
+  {
+    function_(p, random);
+  }
+
+  bool IsActive() const { return function_ != nullptr; }
+
+private:
+  std::function<void(Particle<T>&, ParticleRandom&)> function_;
+};
+
+
+/// <summary>
+/// Type-erased update policy backed by std::function.
+/// </summary>
+template <typename T> class FunctionUpdatePolicy
+{
+public:
+  FunctionUpdatePolicy()
+    : function_()
+  {  }
+
+  template <typename F> FunctionUpdatePolicy(F function)
+    : function_(function)
+  {  }
+
+  void operator()(double dt, ParticleRef<T> p) const
+  {
+    function_(dt, p);
+  }
+
+  bool IsActive() const { return function_ != nullptr; }
+
+private:
+  std::function<void(double, ParticleRef<T>)> function_;
+};
+
+
+/// <summary>
+/// Spawn policy that leaves new particles at the system defaults.
+/// </summary>
+template <typename T> struct NoSpawnPolicy
+{
+  void operator()(Particle<T> &, ParticleRandom &) const {  }
+};
+
+
+/// <summary>
+/// Update policy that does nothing, for systems that only need the built-in integration.
+/// </summary>
+template <typename T> struct NoUpdatePolicy
+{
+  void operator()(double, ParticleRef<T>) const {  }
+};
+
+
+// Whether a policy has anything to run. User functors don't need to provide IsActive,
+// they are always considered active; the built-in policies above overload this.
+template <typename Policy> bool PolicyIsActive(const Policy &)          { return true; }
+template <typename T> bool PolicyIsActive(const FunctionSpawnPolicy<T> &p)  { return p.IsActive(); }
+template <typename T> bool PolicyIsActive(const FunctionUpdatePolicy<T> &p) { return p.IsActive(); }
+template <typename T> bool PolicyIsActive(const NoSpawnPolicy<T> &)         { return false; }
+template <typename T> bool PolicyIsActive(const NoUpdatePolicy<T> &)        { return false; }
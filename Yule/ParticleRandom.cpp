@@ -0,0 +1 @@
+#include "ParticleRandom.hpp"
\ No newline at end of file
@@ -0,0 +1,122 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+
+/// <summary>
+/// Small, fast random number generator for particle code (xoshiro256**). Unlike rand(), each
+/// generator has its own state, so every particle system can own one and several threads can
+/// draw numbers at once without sharing anything, and a given seed always produces the same
+/// sequence on every platform. Seeds are spread across the state with SplitMix64.
+/// </summary>
+class ParticleRandom
+{
+public:
+  explicit ParticleRandom(uint64_t seed = 0)
+  {
+    Seed(seed);
+  }
+
+  // Starts the sequence over from a seed. Any seed works, zero included.
+  void Seed(uint64_t seed)
+  {
+    for (uint64_t& word : state_)
+    {
+      seed += Increment;
+      word = Mix(seed);
+    }
+  }
+
+  /// <summary>
+  /// Next 64 random bits.
+  /// </summary>
+  uint64_t Next()
+  {
+    const uint64_t result = rotate(state_[1] * 5, 7) * 9;
+    const uint64_t shifted = state_[1] << 17;
+    state_[2] ^= state_[0];
+    state_[3] ^= state_[1];
+    state_[1] ^= state_[2];
+    state_[0] ^= state_[3];
+    state_[2] ^= shifted;
+    state_[3] = rotate(state_[3], 45);
+    return result;
+  }
+
+  /// <summary>
+  /// Uniform in [0, 1).
+  /// </summary>
+  double NextDouble()
+  {
+    return (Next() >> 11) * (1.0 / 9007199254740992.0);
+  }
+
+  /// <summary>
+  /// Uniform in [min, max).
+  /// </summary>
+  double NextRange(double min, double max)
+  {
+    return min + (max - min) * NextDouble();
+  }
+
+  /// <summary>
+  /// Uniform whole number in [0, bound), for picking one of a few options.
+  /// </summary>
+  uint32_t NextBelow(uint32_t bound)
+  {
+    return static_cast<uint32_t>(((Next() >> 32) * bound) >> 32);
+  }
+
+  /// <summary>
+  /// Fills an array with numbers uniform in [min, max), the same ones that many calls to
+  /// NextRange would have given, without a call and a scale per number.
+  /// </summary>
+  /// <param name="values">where to write them</param>
+  /// <param name="count">how many to write</param>
+  /// <param name="min"></param>
+  /// <param name="max"></param>
+  void Fill(double* values, size_t count, double min = 0, double max = 1)
+  {
+    const double scale = max - min;
+    for (size_t i = 0; i < count; ++i)
+    {
+      values[i] = min + scale * ((Next() >> 11) * (1.0 / 9007199254740992.0));
+    }
+  }
+
+  /// <summary>
+  /// Scrambles 64 bits so that nearby inputs come out unrelated. Handy for turning a few
+  /// small numbers, like a seed and a chunk index, into a seed of their own.
+  /// </summary>
+  static uint64_t Mix(uint64_t z)
+  {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+  }
+
+  /// <summary>
+  /// The generator for the chunk of particles this thread is currently updating. A particle
+  /// system seeds it before running its update policy over each chunk, from its own seed,
+  /// how many updates it has done, and the chunk's index, so policies that draw from it get
+  /// the same numbers no matter how many threads split the work. Use it instead of rand()
+  /// in update policies.
+  /// </summary>
+  static ParticleRandom& Chunk()
+  {
+    static thread_local ParticleRandom random;
+    return random;
+  }
+
+  // Tuning
+  static const uint64_t Increment = 0x9E3779B97F4A7C15ull; // Golden ratio, as SplitMix64 specifies
+
+private:
+  static uint64_t rotate(uint64_t x, int bits)
+  {
+    return (x << bits) | (x >> (64 - bits));
+  }
+
+  // Variables
+  uint64_t state_[4];
+};
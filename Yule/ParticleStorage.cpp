@@ -0,0 +1 @@
+#include "ParticleStorage.hpp"
\ No newline at end of file
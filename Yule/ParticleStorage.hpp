@@ -0,0 +1,429 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+#include "Particle.hpp"
+#include "ParticleKernels.hpp"
+#include "WorkerPool.hpp"
+
+/// <summary>
+/// Structure-of-arrays particle pool. Every particle field lives in its own contiguous
+/// array, so walking a single field (like life or position) is a straight sweep through memory.
+/// The arrays are allocated once at a fixed capacity and live particles are packed at the
+/// front, so spawning and removing never touch the heap.
+/// Order is NOT preserved: removal swaps the last particle into the freed slot.
+/// </summary>
+template <typename T> class ParticleStorage
+{
+public:
+  // Block update that does nothing, for integrating without one.
+  struct NoBlockUpdate
+  {
+    void operator()(size_t, size_t) const {  }
+  };
+
+  ParticleStorage()
+    : count_(0)
+    , data_()
+    , posX_()
+    , posY_()
+    , velX_()
+    , velY_()
+    , life_()
+    , kill_()
+    , killed_(0)
+    , chunks_()
+  {  }
+
+  /// <summary>
+  /// Copies a particle into the first free slot.
+  /// </summary>
+  /// <param name="p">particle to copy in</param>
+  /// <returns>false if the pool is full and the particle was dropped</returns>
+  bool Add(const Particle<T> &p)
+  {
+    if (count_ >= Capacity())
+    {
+      return false;
+    }
+
+    data_[count_] = p.Data;
+    posX_[count_] = p.PosX;
+    posY_[count_] = p.PosY;
+    velX_[count_] = p.VelX;
+    velY_[count_] = p.VelY;
+    life_[count_] = p.Life;
+    kill_[count_] = 0;
+    ++count_;
+    return true;
+  }
+
+  /// <summary>
+  /// Swap-and-pop removal. The last live particle is moved into the specified slot,
+  /// and its old slot becomes the first free one.
+  /// </summary>
+  /// <param name="index">slot to remove</param>
+  void Remove(size_t index)
+  {
+    const size_t last = count_ - 1;
+    if (index != last)
+    {
+      data_[index] = data_[last];
+      posX_[index] = posX_[last];
+      posY_[index] = posY_[last];
+      velX_[index] = velX_[last];
+      velY_[index] = velY_[last];
+      life_[index] = life_[last];
+      kill_[index] = kill_[last];
+    }
+
+    --count_;
+  }
+
+  /// <summary>
+  /// Advances every particle by dt seconds: accelerates it, ages it, and moves it along its
+  /// velocity. Runs on the widest SIMD kernel available and records which particles died.
+  /// </summary>
+  /// <param name="dt">seconds since last update</param>
+  /// <param name="accelX">horizontal acceleration, units per second squared</param>
+  /// <param name="accelY">vertical acceleration, units per second squared</param>
+  void Integrate(double dt, double accelX = 0, double accelY = 0)
+  {
+    killed_ = ParticleKernels::GetIntegrate()(count_, posX_.data(), posY_.data(), velX_.data(), velY_.data(), life_.data(), dt, accelX, accelY, kill_.data());
+  }
+
+  /// <summary>
+  /// Integrate, fused with an update that has to run over the particles first. Rather than
+  /// one sweep for the update and a second for the kernel, particles go FusedBlock at a time:
+  /// update(begin, end) runs over a block, then the kernel does while the block is still in
+  /// cache. Blocks start at multiples of FusedBlock, so they never straddle a ParallelChunk.
+  /// </summary>
+  /// <param name="dt">seconds since last update</param>
+  /// <param name="accelX">horizontal acceleration, units per second squared</param>
+  /// <param name="accelY">vertical acceleration, units per second squared</param>
+  /// <param name="update">callable as void(size_t begin, size_t end)</param>
+  template <typename BlockUpdate> void Integrate(double dt, double accelX, double accelY, const BlockUpdate &update)
+  {
+    killed_ = integrateRange(0, count_, dt, accelX, accelY, update);
+  }
+
+  /// <summary>
+  /// Compacts away every particle the last Integrate marked as dead. Walks backwards, so
+  /// the particle swapped into a freed slot has always been checked already.
+  /// </summary>
+  void RemoveDead()
+  {
+    if (killed_ == 0)
+    {
+      return;
+    }
+
+    for (size_t i = count_; i-- > 0; )
+    {
+      if (kill_[i])
+      {
+        Remove(i);
+      }
+    }
+
+    killed_ = 0;
+  }
+
+  /// <summary>
+  /// Integrate and RemoveDead, split into ParallelChunk-sized chunks across a worker pool.
+  /// The chunks are integrated in parallel first. Then the live particles past where the
+  /// survivors will end are moved into the dead slots before it, again a chunk of dead slots
+  /// per task. The n-th dead slot always gets the n-th of those live particles, so the
+  /// result doesn't depend on how many threads there are. Like RemoveDead, only the dead
+  /// and the particles moved into their place are touched, though the order comes out
+  /// differently than RemoveDead's. A block update is fused in the same way Integrate does it.
+  /// </summary>
+  /// <param name="pool">threads to split the work across</param>
+  /// <param name="dt">seconds since last update</param>
+  /// <param name="accelX">horizontal acceleration, units per second squared</param>
+  /// <param name="accelY">vertical acceleration, units per second squared</param>
+  /// <param name="update">callable as void(size_t begin, size_t end); called from several threads at once</param>
+  template <typename BlockUpdate = NoBlockUpdate>
+  void IntegrateParallel(WorkerPool &pool, double dt, double accelX = 0, double accelY = 0, const BlockUpdate &update = BlockUpdate())
+  {
+    const size_t chunks = (count_ + ParallelChunk - 1) / ParallelChunk;
+    if (chunks_.size() < chunks)
+    {
+      chunks_.resize(chunks);
+    }
+
+    pool.Run(chunks, [&](size_t chunk)
+    {
+      chunks_[chunk].Killed = integrateRange(chunk * ParallelChunk, chunkEnd(chunk), dt, accelX, accelY, update);
+    });
+
+    size_t killed = 0;
+    for (size_t chunk = 0; chunk < chunks; ++chunk)
+    {
+      killed += chunks_[chunk].Killed;
+    }
+    killed_ = 0;
+    if (killed == 0)
+    {
+      return;
+    }
+
+    // Dead slots before keep are holes; live particles from keep on are movers, and there are
+    // as many of one as the other. Count both per chunk and number them in order.
+    const size_t keep = count_ - killed;
+    size_t holes = 0;
+    size_t movers = 0;
+    for (size_t chunk = 0; chunk < chunks; ++chunk)
+    {
+      ChunkCounts &counts = chunks_[chunk];
+      const size_t begin = chunk * ParallelChunk;
+      const size_t end = chunkEnd(chunk);
+      if (end <= keep)
+      {
+        counts.Holes = counts.Killed;
+      }
+      else if (begin >= keep)
+      {
+        counts.Holes = 0;
+      }
+      else
+      {
+        counts.Holes = 0;
+        for (size_t i = begin; i < keep; ++i)
+        {
+          counts.Holes += kill_[i];
+        }
+      }
+
+      counts.FirstHole = holes;
+      counts.FirstMover = movers;
+      holes += counts.Holes;
+      if (end > keep)
+      {
+        movers += (end - (begin > keep ? begin : keep)) - (counts.Killed - counts.Holes);
+      }
+    }
+
+    pool.Run(chunks, [&](size_t chunk)
+    {
+      if (chunks_[chunk].Holes == 0)
+      {
+        return;
+      }
+
+      // Find the mover numbered the same as this chunk's first hole.
+      const size_t rank = chunks_[chunk].FirstHole;
+      size_t source = keep / ParallelChunk;
+      while (source + 1 < chunks && chunks_[source + 1].FirstMover <= rank)
+      {
+        ++source;
+      }
+
+      size_t from = source * ParallelChunk > keep ? source * ParallelChunk : keep;
+      for (size_t skip = rank - chunks_[source].FirstMover; ; ++from)
+      {
+        if (!kill_[from] && skip-- == 0)
+        {
+          break;
+        }
+      }
+
+      const size_t end = chunkEnd(chunk) < keep ? chunkEnd(chunk) : keep;
+      for (size_t to = chunk * ParallelChunk; to < end; ++to)
+      {
+        if (kill_[to])
+        {
+          while (kill_[from])
+          {
+            ++from;
+          }
+          moveParticle(from++, to);
+        }
+      }
+    });
+
+    count_ = keep;
+  }
+
+  /// <summary>
+  /// Resizes the pool. This is the only call that allocates. Live particles past the
+  /// new capacity are dropped.
+  /// </summary>
+  /// <param name="capacity">maximum number of live particles</param>
+  void SetCapacity(size_t capacity)
+  {
+    if (capacity == Capacity())
+    {
+      return;
+    }
+
+    data_.resize(capacity);
+    posX_.resize(capacity);
+    posY_.resize(capacity);
+    velX_.resize(capacity);
+    velY_.resize(capacity);
+    life_.resize(capacity);
+    kill_.resize(capacity);
+    data_.shrink_to_fit();
+    posX_.shrink_to_fit();
+    posY_.shrink_to_fit();
+    velX_.shrink_to_fit();
+    velY_.shrink_to_fit();
+    life_.shrink_to_fit();
+    kill_.shrink_to_fit();
+
+    if (count_ > capacity)
+    {
+      count_ = capacity;
+    }
+    killed_ = 0;
+  }
+
+  // Tuning
+  static const size_t ParallelChunk = 16384; // Particles per task in IntegrateParallel
+  static const size_t FusedBlock = 256;      // Particles per block when an update is fused in; about 15KB of arrays
+
+  // Drops every particle, keeping the pool.
+  void Clear()
+  {
+    count_ = 0;
+    killed_ = 0;
+  }
+
+  // Particle access by slot
+  ParticleRef<T> At(size_t index)
+  {
+    return ParticleRef<T>(data_[index], posX_[index], posY_[index], velX_[index], velY_[index], life_[index]);
+  }
+
+  // Read-only particle access by slot
+  ConstParticleRef<T> At(size_t index) const
+  {
+    return ConstParticleRef<T>(data_[index], posX_[index], posY_[index], velX_[index], velY_[index], life_[index]);
+  }
+
+  // Allows access to things
+  size_t Size() const     { return count_; }
+  size_t Capacity() const { return life_.size(); }
+  bool Empty() const      { return count_ == 0; }
+  bool Full() const       { return count_ >= Capacity(); }
+  T *Data()            { return data_.data(); }
+  double *PosX()       { return posX_.data(); }
+  double *PosY()       { return posY_.data(); }
+  double *VelX()       { return velX_.data(); }
+  double *VelY()       { return velY_.data(); }
+  double *Life()       { return life_.data(); }
+  const T *Data() const      { return data_.data(); }
+  const double *PosX() const { return posX_.data(); }
+  const double *PosY() const { return posY_.data(); }
+  const double *VelX() const { return velX_.data(); }
+  const double *VelY() const { return velY_.data(); }
+  const double *Life() const { return life_.data(); }
+
+private:
+  // Copies one slot over another, in every field but the kill mask.
+  void moveParticle(size_t from, size_t to)
+  {
+    data_[to] = data_[from];
+    posX_[to] = posX_[from];
+    posY_[to] = posY_[from];
+    velX_[to] = velX_[from];
+    velY_[to] = velY_[from];
+    life_[to] = life_[from];
+  }
+
+  // Integrates [begin, end) with the update fused in a block at a time. Returns how many died.
+  template <typename BlockUpdate> size_t integrateRange(size_t begin, size_t end, double dt, double accelX, double accelY, const BlockUpdate &update)
+  {
+    const ParticleKernels::IntegrateFunc integrate = ParticleKernels::GetIntegrate();
+    size_t killed = 0;
+    for (size_t block = begin; block < end; )
+    {
+      const size_t blockEnd = std::min((block / FusedBlock + 1) * FusedBlock, end);
+      update(block, blockEnd);
+      killed += integrate(blockEnd - block, posX_.data() + block, posY_.data() + block, velX_.data() + block,
+                          velY_.data() + block, life_.data() + block, dt, accelX, accelY, kill_.data() + block);
+      block = blockEnd;
+    }
+    return killed;
+  }
+
+  // Without an update there's nothing to fuse, so the whole range goes through the kernel at once.
+  size_t integrateRange(size_t begin, size_t end, double dt, double accelX, double accelY, const NoBlockUpdate &)
+  {
+    return ParticleKernels::GetIntegrate()(end - begin, posX_.data() + begin, posY_.data() + begin, velX_.data() + begin,
+                                           velY_.data() + begin, life_.data() + begin, dt, accelX, accelY, kill_.data() + begin);
+  }
+
+  // One past the last live slot of a chunk.
+  size_t chunkEnd(size_t chunk) const
+  {
+    const size_t end = (chunk + 1) * ParallelChunk;
+    return end < count_ ? end : count_;
+  }
+
+  // What IntegrateParallel knows about each chunk.
+  struct ChunkCounts
+  {
+    size_t Killed;     // Dead particles
+    size_t Holes;      // Dead particles before the survivors' new end
+    size_t FirstHole;  // Holes in every chunk before this one
+    size_t FirstMover; // Live particles at or past the survivors' new end, in every chunk before this one
+  };
+
+  // Variables
+  size_t count_; // Live particles, packed at the front of every array
+  std::vector<T> data_;
+  std::vector<double> posX_;
+  std::vector<double> posY_;
+  std::vector<double> velX_;
+  std::vector<double> velY_;
+  std::vector<double> life_;
+  std::vector<unsigned char> kill_; // Kill mask written by the integration kernel
+  size_t killed_;                   // Number of set entries in the kill mask
+  std::vector<ChunkCounts> chunks_; // Scratch for IntegrateParallel, grown to the most chunks seen
+};
+
+
+/// <summary>
+/// Lightweight range over a ParticleStorage so particles can still be walked with a range-based
+/// for loop. Dereferencing yields a reference proxy (Ref), so nothing is copied. Use the
+/// ParticleView / ConstParticleView aliases below rather than this directly.
+/// </summary>
+template <typename Storage, typename Ref> class BasicParticleView
+{
+public:
+  class Iterator
+  {
+  public:
+    Iterator(Storage *storage, size_t index)
+      : storage_(storage)
+      , index_(index)
+    {  }
+
+    Ref operator*() const                         { return storage_->At(index_); }
+    Iterator &operator++()                        { ++index_; return *this; }
+    bool operator==(const Iterator &rhs) const    { return index_ == rhs.index_; }
+    bool operator!=(const Iterator &rhs) const    { return index_ != rhs.index_; }
+
+  private:
+    Storage *storage_;
+    size_t index_;
+  };
+
+  explicit BasicParticleView(Storage &storage)
+    : storage_(&storage)
+  {  }
+
+  Iterator begin() const { return Iterator(storage_, 0); }
+  Iterator end() const   { return Iterator(storage_, storage_->Size()); }
+  size_t size() const    { return storage_->Size(); }
+  bool empty() const     { return storage_->Empty(); }
+
+private:
+  Storage *storage_;
+};
+
+// Mutable and read-only views over a particle storage.
+template <typename T> using ParticleView = BasicParticleView<ParticleStorage<T>, ParticleRef<T>>;
+template <typename T> using ConstParticleView = BasicParticleView<const ParticleStorage<T>, ConstParticleRef<T>>;
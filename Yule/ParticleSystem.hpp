@@ -1,10 +1,25 @@
 #pragma once
-#include <list>
-#include <functional>
 #include <iostream>
 #include "Particle.hpp"
+#include "ParticleStorage.hpp"
+#include "ParticlePolicies.hpp"
+#include "ParticleRandom.hpp"
+#include "WorkerPool.hpp"
 
-template <typename T> class ParticleSystem
+/// <summary>
+/// Particle system, parameterized on how particles are configured when spawned and how they
+/// are updated each frame. The default policies wrap std::function, so a plain
+/// ParticleSystem<T> takes any callable (or nullptr). Passing functor types instead lets the
+/// compiler inline the per-particle calls into the update loop.
+/// The update policy isn't folded into the integration kernel itself, which is hand-written
+/// SIMD; instead the two are fused a block at a time (see ParticleStorage::Integrate), so the
+/// policy and the kernel share one trip through memory rather than a sweep each.
+/// Each system owns the generator its spawn policy draws from, so a system's spawns depend
+/// only on its seed, not on what else is using random numbers.
+/// Systems at or above a threshold size update in parallel, across a worker pool that's only
+/// started the first time a system gets that big; smaller ones stay on the calling thread.
+/// </summary>
+template <typename T, typename SpawnPolicy = FunctionSpawnPolicy<T>, typename UpdatePolicy = FunctionUpdatePolicy<T>> class ParticleSystem
 {
 public:
   /// <summary>
@@ -14,12 +29,15 @@ public:
   /// <param name="spawn_delay_ms"></param>
   /// <param name="loops"></param>
   /// <param name="def"></param>
-  /// <param name="create"></param>
-  ParticleSystem(int max, double spawn_delay_seconds, bool loops, const T& def, std::function<void(Particle<T>&)> configure, std::function<void(double, Particle<T>&)> pre_update)
+  /// <param name="configure">spawn policy, run on each new particle with the system's generator</param>
+  /// <param name="pre_update">update policy, run on each particle every frame before integration</param>
+  ParticleSystem(int max, double spawn_delay_seconds, bool loops, const T& def, SpawnPolicy configure = SpawnPolicy(), UpdatePolicy pre_update = UpdatePolicy())
     : posX_(0)
     , posY_(0)
     , maxParticles_(max)
     , maxLifeSeconds_(5)
+    , accelX_(0)
+    , accelY_(0)
     , spawnDelaySeconds_(spawn_delay_seconds)
     , spawnCounter_(spawnDelaySeconds_)
     , oneshotCount_(0)
@@ -28,7 +46,14 @@ public:
     , particles_()
     , configureNewParticle_(configure)
     , preUpdate_(pre_update)
-  {  }
+    , parallelThreshold_(DefaultParallelThreshold)
+    , pool_(nullptr)
+    , seed_(0)
+    , updates_(0)
+    , random_(seed_)
+  {
+    particles_.SetCapacity(maxParticles_);
+  }
 
   /// <summary>
   /// Primary update, should be called every loop. DT is measured in seconds
@@ -36,14 +61,9 @@ public:
   /// <param name="dt">seconds since last update</param>
   void Update(double dt)
   {
-    // Handle pre-update if present
-    if (preUpdate_ != nullptr)
-    {
-      for (Particle<T>& p : particles_)
-      {
-        preUpdate_(dt, p);
-      }
-    }
+    const bool isParallel = particles_.Size() >= parallelThreshold_;
+    const size_t updating = particles_.Size(); // Particles spawned below skip the update policy this frame
+    ++updates_;
 
     // If necessary, add new particles.
     // If there is no delay, add them all immediately.
@@ -52,7 +72,7 @@ public:
     {
       if (spawnDelaySeconds_ == 0)
       {
-        while (particles_.size() < maxParticles_)
+        while (particles_.Size() < maxParticles_)
         {
           AddParticle();
         }
@@ -66,38 +86,65 @@ public:
 
     spawnCounter_ += dt;
 
-    // Update all
-    for (Particle<T>& p : particles_)
+    // Update all in a single batched sweep over the particle arrays, then
+    // swap-and-pop every particle that ran out of life. An update policy runs in the
+    // same sweep, a block ahead of the kernel. Every chunk of particles gets its own
+    // seeding of ParticleRandom::Chunk, whether or not the chunks run in parallel.
+    if (PolicyIsActive(preUpdate_))
     {
-      p.Life -= dt;
-
-      if (p.Life <= 0)
+      integrate(isParallel, dt, [&](size_t begin, size_t end)
       {
-        p.Active = false;
-      }
-
-      p.PosX += p.VelX * dt;
-      p.PosY += p.VelY * dt;
+        if (begin % ParticleStorage<T>::ParallelChunk == 0)
+        {
+          ParticleRandom::Chunk().Seed(ChunkSeed(begin / ParticleStorage<T>::ParallelChunk));
+        }
+        const size_t last = end < updating ? end : updating;
+        for (size_t i = begin; i < last; ++i)
+        {
+          preUpdate_(dt, particles_.At(i));
+        }
+      });
     }
+    else
+    {
+      integrate(isParallel, dt, typename ParticleStorage<T>::NoBlockUpdate());
+    }
+  }
 
-    // Remove every particle no longer marked as active.
-    particles_.remove_if([](const Particle<T> &p) 
-    { 
-      return p.Active == false; 
-    });
+  /// <summary>
+  /// Seed ParticleRandom::Chunk gets for a chunk of particles during the current update.
+  /// </summary>
+  /// <param name="chunk">index of the chunk, ParticleStorage::ParallelChunk particles each</param>
+  uint64_t ChunkSeed(size_t chunk) const
+  {
+    return ParticleRandom::Mix(ParticleRandom::Mix(seed_ ^ updates_) + chunk);
+  }
+
+  /// <summary>
+  /// The pool parallel updates run on. WorkerPool::Shared unless another was set.
+  /// </summary>
+  WorkerPool& GetWorkerPool()
+  {
+    return pool_ ? *pool_ : WorkerPool::Shared();
   }
 
   /// <summary>
   /// Adds a particle, differing to provided function for setting specifics
-  /// like velocity, data, etc.
+  /// like velocity, data, etc. The particle goes into a free slot of the pool,
+  /// which is sized from the max particle count; if the pool is full, nothing spawns.
   /// </summary>
   void AddParticle()
   {
+    if (particles_.Full())
+    {
+      return;
+    }
+
     Particle<T> p1 = Particle<T>(default_, posX_, posY_, 0, 1, maxLifeSeconds_);
 
-    if (configureNewParticle_ != nullptr)
+    if (PolicyIsActive(configureNewParticle_))
     {
-      configureNewParticle_(p1);
+      configureNewParticle_(p1, random_);
     }
 
     if (!isLooping_)
@@ -105,33 +152,67 @@ public:
       ++oneshotCount_;
     }
 
-    particles_.push_back(p1);
+    particles_.Add(p1);
   }
 
   // Allows access to things
-  std::list<Particle<T>> &Particles() { return particles_; }
+  ParticleView<T> Particles()         { return ParticleView<T>(particles_); }
+  ConstParticleView<T> Particles() const { return ConstParticleView<T>(particles_); }
   size_t GetMaxParticles()            { return maxParticles_; }
   double GetPosX()                    { return posX_; }
   double GetPosY()                    { return posY_; }
+  double GetAccelX()                  { return accelX_; }
+  double GetAccelY()                  { return accelY_; }
   double GetSpawnDelay()              { return spawnDelaySeconds_; }
   void SetPos(double x, double y)     { posX_ = x; posY_ = y; }
   void SetPosX(double x)              { posX_ = x; }
   void SetPosY(double y)              { posY_ = y; }
-  void SetMaxParticles(size_t max)    { maxParticles_ = max; }
+  void SetAcceleration(double x, double y) { accelX_ = x; accelY_ = y; }
+  void SetMaxParticles(size_t max)    { maxParticles_ = max; particles_.SetCapacity(max); }
   void SetSpawnDelay(double delay)    { spawnDelaySeconds_ = delay; }
+  size_t GetParallelThreshold()       { return parallelThreshold_; }
+  uint64_t GetSeed()                  { return seed_; }
+  ParticleRandom& GetRandom()         { return random_; }
+  void SetParallelThreshold(size_t threshold) { parallelThreshold_ = threshold; } // SIZE_MAX to never go parallel
+  void SetWorkerPool(WorkerPool* pool)        { pool_ = pool; }                   // nullptr for WorkerPool::Shared
+  void SetSeed(uint64_t seed)                 { seed_ = seed; updates_ = 0; random_.Seed(seed); }
+
+  // Tuning
+  static const size_t DefaultParallelThreshold = 65536; // Particles before Update goes parallel
 
 protected:
+  // Integrates and removes the dead, on the worker pool or not, with update fused in.
+  template <typename BlockUpdate> void integrate(bool isParallel, double dt, const BlockUpdate &update)
+  {
+    if (isParallel)
+    {
+      particles_.IntegrateParallel(GetWorkerPool(), dt, accelX_, accelY_, update);
+    }
+    else
+    {
+      particles_.Integrate(dt, accelX_, accelY_, update);
+      particles_.RemoveDead();
+    }
+  }
+
   // Variables
   size_t maxParticles_;
   double posX_;
   double posY_;
   double maxLifeSeconds_;
+  double accelX_;
+  double accelY_;
   double spawnDelaySeconds_;
   double spawnCounter_;
   int oneshotCount_;
   bool isLooping_;
   const T default_;
-  std::list<Particle<T>> particles_;
-  std::function<void(Particle<T>&)> configureNewParticle_;
-  std::function<void(double, Particle<T>&)> preUpdate_;
+  ParticleStorage<T> particles_;
+  SpawnPolicy configureNewParticle_;
+  UpdatePolicy preUpdate_;
+  size_t parallelThreshold_;
+  WorkerPool* pool_;      // nullptr for WorkerPool::Shared
+  uint64_t seed_;         // Where ParticleRandom::Chunk seeds and the spawn generator start from
+  uint64_t updates_;      // Updates since the seed was set
+  ParticleRandom random_; // Passed to the spawn policy
 };
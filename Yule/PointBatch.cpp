@@ -0,0 +1 @@
+#include "PointBatch.hpp"
\ No newline at end of file
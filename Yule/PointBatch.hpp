@@ -0,0 +1,56 @@
+#pragma once
+#include <vector>
+#include "console-utils.hpp"
+#include "ParticleStorage.hpp"
+
+
+/// <summary>
+/// A particle system's worth of points, laid out for Canvas::DrawPoints. Kept from frame to
+/// frame, so drawing stops allocating once it has grown to fit the biggest system.
+/// </summary>
+struct PointBatch
+{
+public:
+  std::vector<float> x;
+  std::vector<float> y;
+  std::vector<char> glyphs;
+  std::vector<RConsole::Color> colors;
+
+  /// <summary>
+  /// Makes room for count points. Only ever grows, so it settles after the first few frames.
+  /// </summary>
+  /// <param name="count"></param>
+  void Resize(size_t count)
+  {
+    if (x.size() < count)
+    {
+      x.resize(count);
+      y.resize(count);
+      glyphs.resize(count);
+      colors.resize(count);
+    }
+  }
+
+  /// <summary>
+  /// Fills the batch from particles and draws them all with a single Canvas::DrawPoints.
+  /// Each particle is drawn where it will be lead seconds from now, as its Data.visual.
+  /// </summary>
+  /// <param name="particles">view of the particles to draw</param>
+  /// <param name="lead">seconds since the last simulation step</param>
+  /// <param name="color">callable as RConsole::Color(const ConstParticleRef&lt;T&gt;&amp;)</param>
+  template <typename T, typename ColorFunc> void Draw(ConstParticleView<T> particles, double lead, ColorFunc color)
+  {
+    Resize(particles.size());
+    size_t i = 0;
+    for (ConstParticleRef<T> p : particles)
+    {
+      x[i] = static_cast<float>(p.PosX + p.VelX * lead);
+      y[i] = static_cast<float>(p.PosY + p.VelY * lead);
+      glyphs[i] = p.Data.visual;
+      colors[i] = color(p);
+      ++i;
+    }
+
+    RConsole::Canvas::DrawPoints(x.data(), y.data(), glyphs.data(), colors.data(), i);
+  }
+};
@@ -0,0 +1 @@
+#include "RecycleBin.hpp"
\ No newline at end of file
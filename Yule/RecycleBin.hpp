@@ -0,0 +1,211 @@
+#pragma once
+#include <string>
+
+#if defined(_WIN32)
+#include <Windows.h>  // SHFileOperation, and all the caps stuff that goes with it
+#include <locale>     // std::wstring_convert
+#include <codecvt>    // std::codecvt_utf8_utf16. Deprecated in c++17, but nothing has replaced it yet.
+#else
+#include <cstdio>     // rename
+#include <cstdlib>    // getenv
+#include <cctype>     // isalnum
+#include <cerrno>
+#include <ctime>      // DeletionDate
+#include <fcntl.h>    // Creating the .trashinfo exclusively
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+
+/// <summary>
+/// Sends files and folders somewhere they can be gotten back from, instead of deleting them.
+/// On Windows that's the recycle bin. Everywhere else it's the freedesktop.org trash in
+/// $XDG_DATA_HOME/Trash (~/.local/share/Trash by default), which is what file managers on
+/// Linux show as the trash.
+/// </summary>
+class RecycleBin
+{
+public:
+  /// <summary>
+  /// Attempts to silently send the specified file or folder at the path to the recycle bin.
+  /// Nothing is ever deleted outright: if it can't be moved, it's left where it is.
+  /// </summary>
+  /// <param name="path">file or folder, absolute or relative to the working directory</param>
+  /// <returns>True if no issues, false if issues / could not recycle.</returns>
+  static bool TryRecycle(const std::string& path)
+  {
+  #if defined(_WIN32)
+    // Construct and pad path. An extra bit of null won't hurt anything.
+    std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
+    const std::wstring end_coverage = std::wstring(1, L'\0');
+    std::wstring wide_path = converter.from_bytes(path) + end_coverage;
+
+    // Construct request
+    SHFILEOPSTRUCT fileOp;
+    fileOp.hwnd = NULL;
+    fileOp.wFunc = FO_DELETE;
+    fileOp.pFrom = wide_path.c_str();
+    fileOp.pTo = NULL;
+    fileOp.fFlags = FOF_ALLOWUNDO | FOF_NOERRORUI | FOF_NOCONFIRMATION | FOF_SILENT;
+
+    // Pass request and result
+    int result = SHFileOperation(&fileOp);
+    return result == 0;
+  #else
+    const std::string source = absolutePath(path);
+    struct stat info;
+    if (source.empty() || lstat(source.c_str(), &info) != 0)
+    {
+      return false;
+    }
+
+    const std::string trash = trashDirectory();
+    if (trash.empty() || !makeDirectories(trash + "/files") || !makeDirectories(trash + "/info"))
+    {
+      return false;
+    }
+
+    // The .trashinfo is claimed first, exclusively, so two programs trashing the same name
+    // at once can't both pick it. A name already taken gets a number on the end.
+    const std::string name = source.substr(source.find_last_of('/') + 1);
+    for (int attempt = 1; attempt < MaxAttempts; ++attempt)
+    {
+      const std::string candidate = attempt == 1 ? name : name + "." + std::to_string(attempt);
+      const std::string infoPath = trash + "/info/" + candidate + ".trashinfo";
+      const std::string filesPath = trash + "/files/" + candidate;
+
+      const int fd = open(infoPath.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0600);
+      if (fd < 0)
+      {
+        if (errno == EEXIST)
+        {
+          continue;
+        }
+        return false;
+      }
+
+      // Only the files/ name was taken, by something that trashed without an info file.
+      struct stat existing;
+      if (lstat(filesPath.c_str(), &existing) == 0)
+      {
+        close(fd);
+        unlink(infoPath.c_str());
+        continue;
+      }
+
+      const std::string contents = trashInfo(source);
+      const bool isWritten = write(fd, contents.data(), contents.size()) == static_cast<ssize_t>(contents.size());
+      close(fd);
+
+      // A different filesystem can't be renamed across; the file stays put rather than being
+      // copied and deleted behind the user's back.
+      if (isWritten && rename(source.c_str(), filesPath.c_str()) == 0)
+      {
+        return true;
+      }
+
+      unlink(infoPath.c_str());
+      return false;
+    }
+
+    return false;
+  #endif
+  }
+
+  // Tuning
+  static const int MaxAttempts = 1000; // Most numbered names tried before giving up on a name
+
+private:
+#if !defined(_WIN32)
+  // Makes a relative path absolute against the working directory, and drops trailing
+  // slashes so the last component is the name. Symlinks are left alone: the link is what
+  // gets trashed, not what it points at.
+  static std::string absolutePath(const std::string& path)
+  {
+    std::string result = path;
+    if (result.empty() || result[0] != '/')
+    {
+      char cwd[4096];
+      if (!getcwd(cwd, sizeof(cwd)))
+      {
+        return std::string();
+      }
+      result = std::string(cwd) + "/" + result;
+    }
+
+    while (result.size() > 1 && result[result.size() - 1] == '/')
+    {
+      result.erase(result.size() - 1);
+    }
+
+    return result == "/" ? std::string() : result;
+  }
+
+  // $XDG_DATA_HOME/Trash, falling back on $HOME/.local/share/Trash. Empty if neither is set.
+  static std::string trashDirectory()
+  {
+    const char *dataHome = getenv("XDG_DATA_HOME");
+    if (dataHome && dataHome[0] == '/')
+    {
+      return std::string(dataHome) + "/Trash";
+    }
+
+    const char *home = getenv("HOME");
+    if (home && home[0] == '/')
+    {
+      return std::string(home) + "/.local/share/Trash";
+    }
+
+    return std::string();
+  }
+
+  // mkdir -p, private to the user as the trash spec asks.
+  static bool makeDirectories(const std::string& path)
+  {
+    for (size_t slash = path.find('/', 1); ; slash = path.find('/', slash + 1))
+    {
+      const std::string part = path.substr(0, slash);
+      if (mkdir(part.c_str(), 0700) != 0 && errno != EEXIST)
+      {
+        return false;
+      }
+
+      if (slash == std::string::npos)
+      {
+        return true;
+      }
+    }
+  }
+
+  // The .trashinfo contents: where the file came from, percent-encoded, and when it left.
+  static std::string trashInfo(const std::string& source)
+  {
+    static const char hex[] = "0123456789ABCDEF";
+    std::string encoded;
+    for (size_t i = 0; i < source.size(); ++i)
+    {
+      const unsigned char c = static_cast<unsigned char>(source[i]);
+      if (isalnum(c) || c == '/' || c == '-' || c == '_' || c == '.' || c == '~')
+      {
+        encoded += static_cast<char>(c);
+      }
+      else
+      {
+        encoded += '%';
+        encoded += hex[c >> 4];
+        encoded += hex[c & 15];
+      }
+    }
+
+    char date[32] = "";
+    const time_t now = time(nullptr);
+    struct tm local;
+    if (localtime_r(&now, &local))
+    {
+      strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", &local);
+    }
+
+    return "[Trash Info]\nPath=" + encoded + "\nDeletionDate=" + date + "\n";
+  }
+#endif
+};
@@ -5,16 +5,67 @@
 // console static inits
 namespace RConsole
 {
-#define DEFAULT_WIDTH_SIZE (rlutil::tcols() - 1)
-#define DEFAULT_HEIGHT_SIZE rlutil::trows()
+// TerminalSize never reports less than 1, so running without a terminal still gives a usable raster.
+#define DEFAULT_WIDTH_SIZE (TerminalSize::GetColumns() > 1 ? TerminalSize::GetColumns() - 1 : 1)
+#define DEFAULT_HEIGHT_SIZE (TerminalSize::GetRows())
+
+  // Terminal size cache. Defined first so the canvas sizes below can read it; it starts
+  // stale and queries on first use.
+  unsigned int TerminalSize::columns_ = 0;
+  unsigned int TerminalSize::rows_ = 0;
+  std::atomic<bool> TerminalSize::isStale_(true);
+  bool TerminalSize::isWatching_ = false;
+  int TerminalSize::resizePipe_[2] = { -1, -1 };
+  std::chrono::steady_clock::time_point TerminalSize::lastQuery_;
 
   // Static initialization in non-guaranteed order.
   CanvasRaster Canvas::r_ = CanvasRaster(DEFAULT_WIDTH_SIZE, DEFAULT_HEIGHT_SIZE);
   CanvasRaster Canvas::prev_ = CanvasRaster(DEFAULT_WIDTH_SIZE, DEFAULT_HEIGHT_SIZE);
+  CanvasRaster Canvas::backLayer_(1, 1);
+  CanvasRaster Canvas::frontLayer_(1, 1);
+  Field2D<RasterInfo> Canvas::base_(1, 1);
+  unsigned int Canvas::generation_ = CanvasRaster::ZeroGeneration;
+  bool Canvas::hasLayers_ = false;
+  bool Canvas::layersChanged_ = false;
+  CanvasLayer Canvas::layer_ = LAYER_DYNAMIC;
+  CanvasRaster *Canvas::target_ = &Canvas::r_;
   bool Canvas::hasLazyInit_ = false;
   bool Canvas::isDrawing_ = true;
+  std::atomic<int> Canvas::closeSignal_(0);
   unsigned int Canvas::width_ = DEFAULT_WIDTH_SIZE;
   unsigned int Canvas::height_ = DEFAULT_HEIGHT_SIZE;
-  Field2D<bool> Canvas::modified_ = Field2D<bool>(DEFAULT_WIDTH_SIZE, DEFAULT_HEIGHT_SIZE);
+  FrameBuffer Canvas::frame_ = FrameBuffer();
+  OutputTarget Canvas::outputTarget_ = TARGET_TERMINAL;
+  FILE *Canvas::outputFile_ = nullptr;
+  std::vector<char> Canvas::captured_ = std::vector<char>();
+  std::atomic<size_t> Canvas::lastFrameBytes_(0);
+  std::atomic<size_t> Canvas::lastFrameChanges_(0);
+  std::atomic<size_t> Canvas::lastFrameScanned_(0);
+  std::atomic<bool> Canvas::isProfiling_(false);
+  std::atomic<long> Canvas::stageMicroseconds_[STAGE_COUNT] = {};
+  bool Canvas::minimizeOutput_ = true;
+  bool Canvas::clearPending_ = false;
+  unsigned int Canvas::termX_ = UINT_MAX;
+  unsigned int Canvas::termY_ = UINT_MAX;
+  Color Canvas::termColor_ = PREVIOUS_COLOR;
+  std::vector<CellRun> Canvas::runs_ = std::vector<CellRun>();
+  size_t Canvas::runCount_ = 0;
+
+#ifndef RConsole_NO_THREADING
+  // Sized for real when the render thread starts.
+  RasterTripleBuffer Canvas::pipeline_(1, 1);
+  std::thread Canvas::renderThread_;
+  std::atomic<bool> Canvas::isRendering_(false);
+  std::mutex Canvas::renderMutex_;
+  std::condition_variable Canvas::renderWake_;
+#endif
+
+  // rlutil talks to the Windows console through WinAPI unless told to use ANSI,
+  // so only batch frames up as ANSI where the terminal is known to understand it.
+#if defined(_WIN32) && !defined(RLUTIL_USE_ANSI)
+  OutputMode Canvas::outputMode_ = OUTPUT_DIRECT;
+#else
+  OutputMode Canvas::outputMode_ = OUTPUT_BUFFERED;
+#endif
 }
 
@@ -0,0 +1 @@
+#include "WorkerPool.hpp"
\ No newline at end of file
@@ -0,0 +1,187 @@
+#pragma once
+#include <cstddef>
+#include <atomic>
+
+#ifndef RConsole_NO_THREADING
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#endif
+
+
+/// <summary>
+/// A fixed set of worker threads that stay parked between jobs, so splitting work up costs a
+/// wakeup rather than a thread start. A job is a number of tasks, each run exactly once by
+/// whichever thread claims it next; the thread that calls Run works through tasks too, and
+/// Run returns once every task is done. Tasks are claimed from a shared counter, so a thread
+/// that finishes early picks up what's left instead of sitting idle.
+/// Built with RConsole_NO_THREADING, or with no workers, Run just does every task itself.
+/// One job at a time: Run is not reentrant, and shouldn't be called from inside a task.
+/// </summary>
+class WorkerPool
+{
+public:
+  /// <summary>
+  /// Starts the workers. They sleep until there's a job.
+  /// </summary>
+  /// <param name="workers">threads to start, on top of the one calling Run</param>
+  explicit WorkerPool(size_t workers)
+    : invoke_(nullptr)
+    , task_(nullptr)
+    , taskCount_(0)
+    , nextTask_(0)
+  #ifndef RConsole_NO_THREADING
+    , job_(0)
+    , busy_(0)
+    , isStopping_(false)
+  #endif
+  {
+  #ifndef RConsole_NO_THREADING
+    for (size_t i = 0; i < workers; ++i)
+    {
+      threads_.push_back(std::thread(&WorkerPool::work, this));
+    }
+  #else
+    (void)workers;
+  #endif
+  }
+
+  ~WorkerPool()
+  {
+  #ifndef RConsole_NO_THREADING
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      isStopping_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& thread : threads_)
+    {
+      thread.join();
+    }
+  #endif
+  }
+
+  /// <summary>
+  /// Runs task(0) through task(count - 1) across the pool and waits for all of them.
+  /// Which thread runs which task isn't fixed, so anything that has to come out the same
+  /// every time should depend only on the task index.
+  /// </summary>
+  /// <param name="count">number of tasks</param>
+  /// <param name="task">callable as void(size_t index); must be safe to call from several threads at once</param>
+  template <typename Task> void Run(size_t count, const Task& task)
+  {
+  #ifndef RConsole_NO_THREADING
+    if (count > 1 && !threads_.empty())
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        invoke_ = &invokeTask<Task>;
+        task_ = &task;
+        taskCount_ = count;
+        nextTask_ = 0;
+        busy_ = threads_.size();
+        ++job_;
+      }
+      wake_.notify_all();
+      runTasks();
+
+      std::unique_lock<std::mutex> lock(mutex_);
+      done_.wait(lock, [this]() { return busy_ == 0; });
+      return;
+    }
+  #endif
+
+    for (size_t i = 0; i < count; ++i)
+    {
+      task(i);
+    }
+  }
+
+  // Threads working on a job, counting the caller.
+  size_t GetThreadCount() const
+  {
+  #ifndef RConsole_NO_THREADING
+    return threads_.size() + 1;
+  #else
+    return 1;
+  #endif
+  }
+
+  /// <summary>
+  /// A pool shared by everything in the process, with a worker for every hardware thread
+  /// but the caller's. Nothing is started until the first time it's asked for.
+  /// </summary>
+  static WorkerPool& Shared()
+  {
+  #ifndef RConsole_NO_THREADING
+    const unsigned int hardware = std::thread::hardware_concurrency();
+    static WorkerPool pool(hardware > 1 ? hardware - 1 : 0);
+  #else
+    static WorkerPool pool(0);
+  #endif
+    return pool;
+  }
+
+private:
+  WorkerPool(const WorkerPool&);
+  WorkerPool& operator=(const WorkerPool&);
+
+  // Calls back into the job's task with its real type.
+  template <typename Task> static void invokeTask(const void* task, size_t index)
+  {
+    (*static_cast<const Task*>(task))(index);
+  }
+
+  // Claims and runs tasks until there are none left.
+  void runTasks()
+  {
+    for (size_t index = nextTask_++; index < taskCount_; index = nextTask_++)
+    {
+      invoke_(task_, index);
+    }
+  }
+
+#ifndef RConsole_NO_THREADING
+  // Worker body: sleep until there's a new job or the pool is closing, help with it, report in.
+  void work()
+  {
+    unsigned long seen = 0;
+    for (;;)
+    {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait(lock, [this, seen]() { return isStopping_ || job_ != seen; });
+        if (isStopping_)
+        {
+          return;
+        }
+        seen = job_;
+      }
+
+      runTasks();
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (--busy_ == 0)
+      {
+        done_.notify_one();
+      }
+    }
+  }
+#endif
+
+  // Variables
+  void (*invoke_)(const void*, size_t); // The current job
+  const void* task_;
+  size_t taskCount_;
+  std::atomic<size_t> nextTask_;        // Next task index to hand out
+#ifndef RConsole_NO_THREADING
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable wake_;        // Workers wait here for a job
+  std::condition_variable done_;        // Run waits here for the workers to finish
+  unsigned long job_;                   // Bumped for every job, so workers can tell a new one from the last
+  size_t busy_;                         // Workers not yet finished with the current job
+  bool isStopping_;
+#endif
+};
@@ -3,36 +3,89 @@
 #include <chrono>
 #include <thread>
 #include <fstream>
-
-// Recycle bin utilities
-#include <Windows.h>  // I mean, recycle bin is a fairly windows thing, so... yeah this is for all the caps stuff.
-#include <locale>     // std::wstring_convert.
-#include <codecvt>    // std::codecvt_utf8_utf16. c++2017 convert. Planned to be deprecated in c++26, apparently.
-#include <string>     // std::string, std::wstring.
-#include <iostream>   // std::cout.
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
+#include <string>
 
 // Yule specific stuff
 #include "console-utils.hpp"
 #include "ParticleSystem.hpp"
+#include "ParticleDistribution.hpp"
 #include "Yule.hpp"
 #include "console-input.h"
+#include "RecycleBin.hpp"
 
 // Global Variables (oops, but not sorry)
 int windowWidth;
 int windowHeight;
 long lastFrameMicroseconds = 1000; // Use a default value of 1 millisecond to have at least something there.
+double renderHz = DEFAULT_RENDER_HZ; // What the frame pacer is currently drawing at
+bool isIdle = false;                 // If the frame pacer has slowed down to idle
+double wakeupsPerSecond = 0;         // How often the main loop wakes up, to keep an eye on power use
 int numberBurned = 0;
-
-bool displayFrameTime = false; // Input tracking for frame time
+FrameProfiler profiler;              // Per-stage timings, only taken while the overlay is shown
+RConsole::Sprite backgroundLog;      // The log behind the fire
+RConsole::Sprite foregroundLog;      // The log in front of it
+PointBatch particlePoints;           // Scratch for drawing a particle system in one call
+
+// How much longer than its base lifetime a particle lives. Most burn out quickly, a few linger.
+const ParticleDistribution particleLifetimes([](double uniform) { return -log10(uniform * 30 + .001); });
+
+// Log artwork. Shades run from full block to light: # = - .
+// Colors are 6 brown, e yellow, 8 dark grey.
+const char* BACKGROUND_LOG_SPRITE =
+  "[legend]\n"
+  "# 219\n"
+  "= 178\n"
+  "- 177\n"
+  ". 176\n"
+  "[glyphs]\n"
+  " ##########--\n"
+  "#=========-==-\n"
+  "=========.==#-\n"
+  "==--------=-=-\n"
+  " ..........-=\n"
+  "[colors]\n"
+  " 666666666666\n"
+  "66666666666ee6\n"
+  "6666666666eee6\n"
+  "6666666666eee6\n"
+  " 8888888866e6\n";
+
+const char* FOREGROUND_LOG_SPRITE =
+  "[legend]\n"
+  "# 219\n"
+  "= 178\n"
+  "- 177\n"
+  ". 176\n"
+  "[glyphs]\n"
+  "      #-\n"
+  "     #==-\n"
+  "   ##==-.\n"
+  "  #===-.\n"
+  " #==--.\n"
+  "-#=-..\n"
+  "--=..\n"
+  "[colors]\n"
+  "      66\n"
+  "     6666\n"
+  "   666666\n"
+  "  666666\n"
+  " 666666\n"
+  "6ee666\n"
+  "6ee68\n";
+
+bool displayProfiler = false;  // Input tracking for the per-stage timing overlay
 bool displayColors = false;    // Input tracking for color debug display
 bool displayBurnCount = true;  // Input tracking for default file burnt count display
+bool staticLayersStale = true; // The logs or burn count need drawing into the static layers again
 
 bool pendingScrapeData = false; // Scrape tracking: Basically, the file to 'burn'
 int scrapedLocation = 0;        // Scrape tracking: Stack of characters left to 'burn'
 char scraped[200];              // Scrape tracking: First N bytes of the file specified by size
 
-std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> wstringConverter; 
-
 void Clear()
 {
   RConsole::Canvas::ReInit(windowWidth, windowHeight);
@@ -44,80 +97,270 @@ void Clear()
 /// IT'S MAIN BAYBEEEEE
 /// </summary>
 /// <returns>never</returns>
-int main()
+int main(int argc, char* argv[])
 {
-  // Data config/setup
+  // Data config/setup. A deterministic run draws a set number of frames at a fixed dt as
+  // fast as it can, with no input, so the same seed always writes the same bytes.
+  const YuleSettings settings = ParseArguments(argc, argv);
+  const bool isDeterministic = settings.frames > 0;
   ParticleData data = ParticleData();
-  ParticleSystem<ParticleData> flameParticles = ParticleSystem<ParticleData>(100, 0.015, true, data, CreateParticle, UpdateParticle);
+  ParticleSystem<ParticleData> flameParticles = ParticleSystem<ParticleData>(100, 0.015, true, data, CreateParticle, nullptr);
+  flameParticles.SetSeed(settings.seed);
+  flameParticles.SetAcceleration(0, PARTICLE_GRAVITY);
   ParticleSystem<ParticleData>* fileParticles = nullptr;
   InputParser parser = InputParser();
+  SetupProfiler();
+  LoadSprites();
   
-  // Console config/setup
-  windowWidth = CONSOLE_WIDTH;
-  windowHeight = CONSOLE_HEIGHT;
+  // Console config/setup. Headless output has to be set up before anything is drawn.
+  if (!RConsole::Canvas::SetOutputTarget(settings.target, settings.outputPath.c_str()))
+  {
+    std::cerr << "Could not open " << settings.outputPath << " for output" << std::endl;
+    return 1;
+  }
+
+  windowWidth = settings.width > 0 ? settings.width : CONSOLE_WIDTH;
+  windowHeight = settings.height > 0 ? settings.height : CONSOLE_HEIGHT;
   RConsole::Canvas::ReInit(windowWidth, windowHeight);
   RConsole::Canvas::SetCursorVisible(false);
   Clear();
 
-  while (true)
+  // Terminal writes happen on their own thread, so a slow terminal can't stretch the frame
+  // time the simulation steps by. Does nothing if built with RConsole_NO_THREADING.
+  // A deterministic run presents every frame itself instead, since the render thread drops
+  // whichever frames it can't keep up with.
+  if (!isDeterministic)
+  {
+    RConsole::Canvas::StartRenderThread();
+  }
+
+  // The simulation ticks at a fixed rate no matter how often frames get drawn, and the
+  // pacer sleeps between frames so an idle Yule stays cheap.
+  FramePacer pacer = FramePacer(settings.simHz, settings.renderHz);
+  pacer.WakeOn(RConsole::TerminalSize::GetResizeHandle());
+  size_t droppedFrames = RConsole::Canvas::GetDroppedFrames();
+
+  // A deterministic run feeds the pacer its own clock, moving exactly dt a frame.
+  const FramePacer::Clock::duration frameDuration = std::chrono::duration_cast<FramePacer::Clock::duration>(std::chrono::duration<double>(settings.dt));
+  const FramePacer::Clock::time_point runStart = FramePacer::Clock::now();
+  FramePacer::Clock::time_point virtualNow = runStart;
+  pacer.Restart(virtualNow);
+  unsigned long framesDrawn = 0;
+  size_t bytesWritten = 0;
+
+  while (!isDeterministic || framesDrawn < settings.frames)
   {
     // Prepare
-    Timepoint start = std::chrono::steady_clock::now();
-    const double lastFrameMS = lastFrameMicroseconds / 1000.0;
-    const double lastFrameS = lastFrameMS / 1000.0;
-    ResizeIfNeeded();
-
-    // Update
-    parser.HandleInput(ProcessInputChar, ProcessInputString);
-    flameParticles.Update(lastFrameS);
-    HandlePendingScrapedData(fileParticles, data, lastFrameS);
-    TryUpdate(fileParticles, lastFrameS);
+    if (isDeterministic)
+    {
+      virtualNow += frameDuration;
+      pacer.BeginFrame(virtualNow);
+    }
+    else
+    {
+      pacer.BeginFrame();
+    }
+    lastFrameMicroseconds = pacer.GetFrameMicroseconds();
+    renderHz = pacer.GetRenderHz();
+    isIdle = pacer.IsIdle();
+    wakeupsPerSecond = pacer.GetWakeupsPerSecond();
+    const FramePacer::Clock::time_point workStart = profiler.IsEnabled() ? FramePacer::Clock::now() : FramePacer::Clock::time_point();
+    if (!settings.isFixedSize)
+    {
+      ResizeIfNeeded();
+    }
+
+    // Update. Each stage is timed for the profiler overlay; while it's hidden, a timer is just a check.
+    if (!isDeterministic)
+    {
+      FrameProfiler::Scope scope(profiler, PROFILE_INPUT);
+      parser.HandleInput(ProcessInputChar, ProcessInputString);
+    }
+    while (pacer.StepSimulation())
+    {
+      const double step = pacer.GetStep();
+      {
+        FrameProfiler::Scope scope(profiler, PROFILE_FLAME_UPDATE);
+        flameParticles.Update(step);
+      }
+      HandlePendingScrapedData(fileParticles, data, flameParticles.GetRandom(), step);
+      {
+        FrameProfiler::Scope scope(profiler, PROFILE_FILE_UPDATE);
+        TryUpdate(fileParticles, step);
+      }
+    }
     RConsole::Canvas::Update();
+    RecordCanvasStages();
+
+    // Draw. The logs and burn count sit in the canvas's static layers, and are only drawn
+    // again when they change; everything else is drawn fresh every frame.
+    const double lead = pacer.GetInterpolation();
+    {
+      FrameProfiler::Scope scope(profiler, PROFILE_DRAW_STATIC);
+      if (staticLayersStale)
+      {
+        RedrawStaticLayers();
+      }
+    }
+    {
+      FrameProfiler::Scope scope(profiler, PROFILE_DRAW_FLAME);
+      DrawParticles(flameParticles, lead);
+    }
+    {
+      FrameProfiler::Scope scope(profiler, PROFILE_DRAW_FILE);
+      DrawParticles(fileParticles, lead);
+    }
+    {
+      FrameProfiler::Scope scope(profiler, PROFILE_DRAW_UI);
+      DrawColorDisplay(displayColors);
+    }
+    if (profiler.IsEnabled() && workStart != FramePacer::Clock::time_point())
+    {
+      profiler.Record(PROFILE_WORK, std::chrono::duration_cast<std::chrono::microseconds>(FramePacer::Clock::now() - workStart).count());
+    }
+    DrawProfiler(displayProfiler);
 
-    // Draw
-    DrawBackgroundLog();
-    DrawParticles(flameParticles);
-    DrawParticles(fileParticles);
-    DrawForegroundLog();
-    DrawFrameTime(displayFrameTime);
-    DrawColorDisplay(displayColors);
-    DrawBurnCount(displayBurnCount);
-
-    // Resolve (Post-update)
-    std::this_thread::yield(); // Be polite! 
-    std::this_thread::sleep_until(start + std::chrono::milliseconds(4)); // Max speed of 
-    Timepoint end = std::chrono::steady_clock::now();
-    lastFrameMicroseconds = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    // Resolve (Post-update). A deterministic run goes straight on to the next frame, keeping
+    // the captured output from piling up. Otherwise, frames the render thread had to drop mean
+    // the terminal isn't keeping up, so the pacer backs off, and frames that change nothing let it idle.
+    if (isDeterministic)
+    {
+      ++framesDrawn;
+      bytesWritten += RConsole::Canvas::GetLastFrameBytes();
+      if (settings.target == RConsole::TARGET_MEMORY)
+      {
+        RConsole::Canvas::ClearCapturedOutput();
+      }
+      continue;
+    }
+
+    const size_t dropped = RConsole::Canvas::GetDroppedFrames();
+    pacer.EndFrame(dropped != droppedFrames, RConsole::Canvas::GetLastFrameChanges() != 0);
+    droppedFrames = dropped;
   }
 
+  const double seconds = std::chrono::duration<double>(FramePacer::Clock::now() - runStart).count();
+  RConsole::Canvas::Shutdown();
+  RConsole::Canvas::SetCursorVisible(true);
+  ReportRun(framesDrawn, seconds, bytesWritten);
+
   delete fileParticles;
   return 0;
 }
 
 /// <summary>
-/// Attempts to silently send the specified file or folder at the path to the recycle bin
+/// Prints how a deterministic run went to stderr, out of the way of any frames on stdout.
+/// Bytes are only counted for buffered output.
 /// </summary>
-/// <param name="path"></param>
-/// <returns>True if no issues, false if issues / could not delete.</returns>
-bool TryRecyclePath(std::string path)
+/// <param name="frames">frames drawn</param>
+/// <param name="seconds">real time the frames took</param>
+/// <param name="bytes">bytes of output the frames made</param>
+void ReportRun(unsigned long frames, double seconds, size_t bytes)
+{
+  const double fps = seconds > 0 ? frames / seconds : 0;
+  const double bytesPerFrame = frames > 0 ? static_cast<double>(bytes) / frames : 0;
+  std::cerr << frames << " frames in " << seconds << "s, " << fps << " fps, "
+    << bytes << " bytes, " << bytesPerFrame << " bytes/frame" << std::endl;
+}
+
+/// <summary>
+/// Reads settings off the command line. Unknown arguments are ignored, as are numbers that
+/// aren't positive.
+///   --sim-hz N      Fixed simulation steps per second
+///   --render-hz N   Target frames drawn per second
+///   --frames N      Draw N frames as fast as possible, then exit and report how long they took
+///   --dt S          Seconds each of those frames moves time forward by (default 1/render-hz)
+///   --seed N        Seed for particle randomness
+///   --headless T    Send frames to memory, null, or a file path instead of the terminal
+///   --size WxH      Draw at a fixed size instead of following the terminal
+/// </summary>
+/// <param name="argc"></param>
+/// <param name="argv"></param>
+/// <returns>settings, with defaults for anything not specified</returns>
+YuleSettings ParseArguments(int argc, char* argv[])
 {
-  // Construct and pad path. An extra bit of null won't hurt anything.
-  const std::wstring end_coverage = std::wstring(1, L'\0');
-  std::wstring wide_path = wstringConverter.from_bytes(path) + end_coverage;
-
-  // Construct request
-  SHFILEOPSTRUCT fileOp;
-  fileOp.hwnd = NULL;
-  fileOp.wFunc = FO_DELETE;
-  fileOp.pFrom = wide_path.c_str();
-  fileOp.pTo = NULL;
-  fileOp.fFlags = FOF_ALLOWUNDO | FOF_NOERRORUI | FOF_NOCONFIRMATION | FOF_SILENT;
-
-  // Pass request and result
-  int result = SHFileOperation(&fileOp);
-  return result == 0;
+  YuleSettings settings = YuleSettings();
+  double dt = 0;
+  for (int i = 1; i + 1 < argc; ++i)
+  {
+    const char* option = argv[i];
+    const char* value = argv[++i];
+    const double number = std::strtod(value, nullptr);
+
+    if (std::strcmp(option, "--sim-hz") == 0 && number > 0)
+    {
+      settings.simHz = number;
+    }
+    else if (std::strcmp(option, "--render-hz") == 0 && number > 0)
+    {
+      settings.renderHz = number;
+    }
+    else if (std::strcmp(option, "--frames") == 0 && number > 0)
+    {
+      settings.frames = std::strtoul(value, nullptr, 10);
+    }
+    else if (std::strcmp(option, "--dt") == 0 && number > 0)
+    {
+      dt = number;
+    }
+    else if (std::strcmp(option, "--seed") == 0)
+    {
+      settings.seed = static_cast<unsigned int>(std::strtoul(value, nullptr, 10));
+    }
+    else if (std::strcmp(option, "--headless") == 0)
+    {
+      if (std::strcmp(value, "memory") == 0)
+      {
+        settings.target = RConsole::TARGET_MEMORY;
+      }
+      else
+      {
+        settings.target = RConsole::TARGET_FILE;
+        settings.outputPath = std::strcmp(value, "null") == 0 ? NULL_DEVICE : value;
+      }
+    }
+    else if (std::strcmp(option, "--size") == 0)
+    {
+      int width = 0;
+      int height = 0;
+      if (std::sscanf(value, "%dx%d", &width, &height) == 2 && width > 0 && height > 0)
+      {
+        settings.width = width;
+        settings.height = height;
+      }
+    }
+    else
+    {
+      --i; // Not an option with a value, so the next argument gets its own look.
+    }
+  }
+
+  // Headless output has no terminal to take a size from.
+  if (settings.target != RConsole::TARGET_TERMINAL && settings.width == 0)
+  {
+    settings.width = HEADLESS_WIDTH;
+    settings.height = HEADLESS_HEIGHT;
+  }
+
+  // Frames default to whatever the render rate would space them at, and nothing that isn't
+  // drawing to a live terminal cares about resizes.
+  settings.dt = dt > 0 ? dt : 1.0 / settings.renderHz;
+  settings.isFixedSize = settings.width > 0 || settings.frames > 0 || settings.target != RConsole::TARGET_TERMINAL;
+  return settings;
 }
 
+YuleSettings::YuleSettings() :
+  simHz(DEFAULT_SIM_HZ)
+  , renderHz(DEFAULT_RENDER_HZ)
+  , frames(0)
+  , dt(1.0 / DEFAULT_RENDER_HZ)
+  , seed(DEFAULT_SEED)
+  , target(RConsole::TARGET_TERMINAL)
+  , outputPath()
+  , width(0)
+  , height(0)
+  , isFixedSize(false)
+{ }
 
 /// <summary>
 /// Wrap to cover null system updates
@@ -147,8 +390,9 @@ void TryUpdate(ParticleSystem<ParticleData>& particle_system, const double& dt)
 /// </summary>
 /// <param name="scrapeSys"></param>
 /// <param name="data"></param>
+/// <param name="seeds">where the new system's seed is drawn from</param>
 /// <param name="lastFrameS"></param>
-void HandlePendingScrapedData(ParticleSystem<ParticleData>*& scrapeSys, ParticleData& data, const double& dt)
+void HandlePendingScrapedData(ParticleSystem<ParticleData>*& scrapeSys, ParticleData& data, ParticleRandom& seeds, const double& dt)
 {
   if (!pendingScrapeData)
   {
@@ -161,7 +405,9 @@ void HandlePendingScrapedData(ParticleSystem<ParticleData>*& scrapeSys, Particle
     delete scrapeSys;
   }
 
-  scrapeSys = new ParticleSystem<ParticleData>(sizeof(scraped), 0.003, false, data, CreateFileParticle, UpdateParticle);
+  scrapeSys = new ParticleSystem<ParticleData>(sizeof(scraped), 0.003, false, data, CreateFileParticle, nullptr);
+  scrapeSys->SetAcceleration(0, PARTICLE_GRAVITY);
+  scrapeSys->SetSeed(seeds.Next());
 
   scrapedLocation = 0;
   pendingScrapeData = false;
@@ -169,43 +415,111 @@ void HandlePendingScrapedData(ParticleSystem<ParticleData>*& scrapeSys, Particle
 
 /// <summary>
 /// Given a system, goes through and draws the particle, extracting the visual from the data.
+/// Reads straight out of the system through a const view into particlePoints, then hands
+/// the whole system to the canvas in a single call. Each particle is drawn where it will be lead seconds past its last simulation step,
+/// which smooths motion when frames land between fixed steps.
 /// </summary>
 /// <param name="particle_system"></param>
-void DrawParticles(ParticleSystem<ParticleData>& particle_system)
+/// <param name="lead">seconds since the last simulation step</param>
+void DrawParticles(const ParticleSystem<ParticleData>& particle_system, double lead)
 {
-  std::list<Particle<ParticleData>> particles = particle_system.Particles();
-  for (Particle<ParticleData>& p : particles)
-  {
-    RConsole::Canvas::Draw(p.Data.visual, static_cast<float>(p.PosX), static_cast<float>(p.PosY), DetermineColor(p));
-  }
+  particlePoints.Draw(particle_system.Particles(), lead, DetermineColor);
 }
 
 /// <summary>
 /// Given a system, goes through and draws the particle, extracting the visual from the data.
 /// </summary>
 /// <param name="particle_system"></param>
-void DrawParticles(ParticleSystem<ParticleData>* particle_system)
+/// <param name="lead">seconds since the last simulation step</param>
+void DrawParticles(const ParticleSystem<ParticleData>* particle_system, double lead)
 {
   if (particle_system != nullptr)
   {
-    DrawParticles(*particle_system);
+    DrawParticles(*particle_system, lead);
+  }
+}
+
+/// <summary>
+/// Adds every stage the overlay shows to the profiler, in the order of ProfileStage.
+/// </summary>
+void SetupProfiler()
+{
+  const char* names[PROFILE_COUNT]
+  {
+    "input",
+    "flame update",
+    "file update",
+    "diff",
+    "clearPrevious",
+    "writeRaster",
+    "copy",
+    "draw static",
+    "draw flame",
+    "draw file",
+    "draw ui",
+    "frame work"
+  };
+
+  for (int stage = 0; stage < PROFILE_COUNT; ++stage)
+  {
+    profiler.AddStage(names[stage]);
+  }
+}
+
+/// <summary>
+/// Hands the profiler what Canvas timed of the last frame it got out. With the render thread
+/// running, that's whichever frame the thread wrote last.
+/// </summary>
+void RecordCanvasStages()
+{
+  if (!profiler.IsEnabled())
+  {
+    return;
   }
+
+  profiler.Record(PROFILE_DIFF, RConsole::Canvas::GetStageMicroseconds(RConsole::STAGE_DIFF));
+  profiler.Record(PROFILE_CLEAR_PREVIOUS, RConsole::Canvas::GetStageMicroseconds(RConsole::STAGE_CLEAR_PREVIOUS));
+  profiler.Record(PROFILE_WRITE_RASTER, RConsole::Canvas::GetStageMicroseconds(RConsole::STAGE_WRITE_RASTER));
+  profiler.Record(PROFILE_COPY, RConsole::Canvas::GetStageMicroseconds(RConsole::STAGE_COPY));
 }
 
 /// <summary>
-/// Shows the number of milliseconds the last frame took 
+/// Shows rolling min/avg/p99 microseconds for every profiled stage in the top right, with the
+/// time between frames, the rate frames are being drawn at, and how much the last one wrote
+/// to the terminal underneath.
 /// </summary>
 /// <param name="is_displaying"></param>
-void DrawFrameTime(bool is_displaying)
+void DrawProfiler(bool is_displaying)
 {
   if (!is_displaying)
   {
     return;
   }
 
+  const int width = 38;
+  const int x = windowWidth > width ? windowWidth - width : 0;
+  char line[64];
+
+  std::snprintf(line, sizeof(line), "%-16s%7s%7s%7s", "stage (us)", "min", "avg", "p99");
+  RConsole::Canvas::DrawString(line, x, 0, RConsole::GREY);
+
+  int y = 1;
+  for (size_t stage = 0; stage < profiler.GetStageCount(); ++stage, ++y)
+  {
+    const FrameProfiler::Stats stats = profiler.GetStats(stage);
+    std::snprintf(line, sizeof(line), "%-16s%7ld%7ld%7ld", profiler.GetStageName(stage).c_str(), stats.Min, stats.Avg, stats.P99);
+    RConsole::Canvas::DrawString(line, x, y, RConsole::DARKGREY);
+  }
+
   std::string composedFPS = std::to_string(lastFrameMicroseconds / 1000) + "." + std::to_string(lastFrameMicroseconds % 1000) + "ms";
-  RConsole::Canvas::DrawString(composedFPS.c_str(), 0, 0, RConsole::DARKGREY);
-  RConsole::Canvas::DrawString("(toggle with d or f)", 0, 1, RConsole::DARKGREY);
+  composedFPS += " " + (isIdle ? std::string("idle") : std::to_string(static_cast<int>(renderHz + 0.5)) + "hz");
+  composedFPS += " " + std::to_string(static_cast<int>(wakeupsPerSecond + 0.5)) + " wakeups/s";
+  if (RConsole::Canvas::GetOutputMode() == RConsole::OUTPUT_BUFFERED)
+  {
+    composedFPS += " " + std::to_string(RConsole::Canvas::GetLastFrameBytes()) + " bytes";
+  }
+  RConsole::Canvas::DrawString(composedFPS.c_str(), x, y, RConsole::DARKGREY);
+  RConsole::Canvas::DrawString("(toggle with d or f)", x, y + 1, RConsole::DARKGREY);
 }
 
 /// <summary>
@@ -301,7 +615,8 @@ void ProcessInputString(std::string path)
   {
     // We can safely assume it's closed
     ++numberBurned;
-    TryRecyclePath(path); // Could still be a folder, so go for it anyways.
+    staticLayersStale = true;
+    RecycleBin::TryRecycle(path); // Could still be a folder, so go for it anyways.
     return;
   }
 
@@ -310,7 +625,8 @@ void ProcessInputString(std::string path)
 
   fileObject.close();
   ++numberBurned;
-  TryRecyclePath(path);
+  staticLayersStale = true;
+  RecycleBin::TryRecycle(path);
 }
 
 /// <summary>
@@ -323,21 +639,26 @@ void ProcessInputChar(char key)
     case 'b':
     case 'c':
       displayBurnCount = !displayBurnCount;
+      staticLayersStale = true;
       break;
 
     case 'd':
     case 'f':
-      displayFrameTime = !displayFrameTime;
+      displayProfiler = !displayProfiler;
       displayColors = !displayColors;
+      profiler.SetEnabled(displayProfiler);
+      RConsole::Canvas::SetProfiling(displayProfiler);
       break;
   }
 }
 
 /// <summary>
 /// Monitors window size and handles canvas re-initialization if needed.
+/// The size is cached, and only asked for again after the terminal reports a resize.
 /// </summary>
 void ResizeIfNeeded()
 {
+  RConsole::TerminalSize::Refresh();
   const int windowFrameWidth = CONSOLE_WIDTH;
   const int windowFrameHeight = CONSOLE_HEIGHT;
 
@@ -346,9 +667,8 @@ void ResizeIfNeeded()
     windowWidth = windowFrameWidth;
     windowHeight = windowFrameHeight;
 
-    RConsole::Canvas::ReInit(windowFrameWidth, windowFrameHeight);
-    RConsole::Canvas::ForceClearEverything();
-    RConsole::Canvas::SetCursorVisible(false);
+    RConsole::Canvas::Resize(windowFrameWidth, windowFrameHeight);
+    staticLayersStale = true;
   }
 }
 
@@ -356,15 +676,13 @@ void ResizeIfNeeded()
 /// Passed as argument to allow creation of new particles to take custom parameters.
 /// </summary>
 /// <param name="p"></param>
-void CreateParticle(Particle<ParticleData>& p)
+void CreateParticle(Particle<ParticleData>& p, ParticleRandom& random)
 {
-  p.VelX = (rand() % 200 - 100) / 30.0;
-  p.VelY = (rand() % 200 - 100) / 10.0;
-  p.PosX = windowWidth / 2 + (rand() % 8 - 4);
+  p.VelX = random.NextRange(-100, 100) / 30.0;
+  p.VelY = random.NextRange(-100, 100) / 10.0;
+  p.PosX = windowWidth / 2 + (static_cast<int>(random.NextBelow(8)) - 4);
   p.PosY = windowHeight - 3;
-
-  const double rand0to30 = (rand() % 30000 / 1000.0);
-  p.Life = 2 - log10(rand0to30 + .001);
+  p.Life = 2 + particleLifetimes.Sample(random);
 
   p.Data.startLife = p.Life;
 
@@ -377,22 +695,20 @@ void CreateParticle(Particle<ParticleData>& p)
     static_cast<unsigned char>(254), // square (centered)
     static_cast<unsigned char>(254), // square (centered)
   };
-  p.Data.visual = charset[rand() % 6];
+  p.Data.visual = charset[random.NextBelow(6)];
 }
 
 /// <summary>
 /// An effect designed to look like throwing a piece of cardboard or paper into a fire - a 'fwoosh' if you will.
 /// </summary>
 /// <param name="p"></param>
-void CreateFileParticle(Particle<ParticleData>& p)
+void CreateFileParticle(Particle<ParticleData>& p, ParticleRandom& random)
 {
-  p.VelX = (rand() % 1000 / 1000.0 - 0.5) * 20;
-  p.VelY = (rand() % 1000 / 1000.0) * -5;
-  p.PosX = windowWidth / 2 + (rand() % 8 - 4);
+  p.VelX = (random.NextDouble() - 0.5) * 20;
+  p.VelY = random.NextDouble() * -5;
+  p.PosX = windowWidth / 2 + (static_cast<int>(random.NextBelow(8)) - 4);
   p.PosY = windowHeight - 1;
-
-  const double rand0to30 = (rand() % 30000 / 1000.0);
-  p.Life = 2.5 - log10(rand0to30 + .001);
+  p.Life = 2.5 + particleLifetimes.Sample(random);
 
   p.Data.startLife = p.Life;
 
@@ -411,21 +727,12 @@ void CreateFileParticle(Particle<ParticleData>& p)
   ++scrapedLocation;
 }
 
-/// <summary>
-/// Passed as argument to allow custom particle updating.
-/// </summary>
-/// <param name="p"></param>
-void UpdateParticle(double dt, Particle<ParticleData>& p)
-{
-  p.VelY -= 5 * dt;
-}
-
 /// <summary>
 /// Correlate a particle color to a given 
 /// </summary>
 /// <param name="p"></param>
 /// <returns></returns>
-RConsole::Color DetermineColor(Particle<ParticleData> p)
+RConsole::Color DetermineColor(const ConstParticleRef<ParticleData>& p)
 {
   double t = p.Life / p.Data.startLife;
 
@@ -453,158 +760,50 @@ RConsole::Color DetermineColor(Particle<ParticleData> p)
 }
 
 /// <summary>
-/// Draws a log intended for the background, pixel by pixel!
+/// Compiles the log artwork into sprites. Only needs doing once.
 /// </summary>
-void DrawBackgroundLog()
+void LoadSprites()
 {
-  const unsigned char intensity[]
+  if (!backgroundLog.Load(BACKGROUND_LOG_SPRITE) || !foregroundLog.Load(FOREGROUND_LOG_SPRITE))
   {
-    static_cast<unsigned char>(219),
-    static_cast<unsigned char>(178),
-    static_cast<unsigned char>(177),
-    static_cast<unsigned char>(176)
-  };
+    throw "The log sprites didn't compile. Not good.";
+  }
+}
 
+/// <summary>
+/// Draws everything that stays put into the canvas's static layers: the back log behind the
+/// fire, and the front log and burn count in front of it. Canvas only recomposites and
+/// rediffs them when this runs, so call it when one of them changes, not every frame.
+/// </summary>
+void RedrawStaticLayers()
+{
+  RConsole::Canvas::SetLayer(RConsole::LAYER_BACK);
+  RConsole::Canvas::ClearLayer(RConsole::LAYER_BACK);
+  DrawBackgroundLog();
+
+  RConsole::Canvas::SetLayer(RConsole::LAYER_FRONT);
+  RConsole::Canvas::ClearLayer(RConsole::LAYER_FRONT);
+  DrawForegroundLog();
+  DrawBurnCount(displayBurnCount);
+
+  RConsole::Canvas::SetLayer(RConsole::LAYER_DYNAMIC);
+  staticLayersStale = false;
+}
+
+/// <summary>
+/// Draws a log intended for the background, a row at a time.
+/// </summary>
+void DrawBackgroundLog()
+{
   // Image is 14x5
-  const int x = windowWidth / 2 - (14 / 2);
-  const int y = windowHeight - 5;
-
-  RConsole::Color brown = RConsole::Color::BROWN;
-  RConsole::Color yellow = RConsole::Color::YELLOW;
-  RConsole::Color grey = RConsole::Color::DARKGREY;
-
-  RConsole::Canvas::Draw(intensity[0], x + 1, y + 0, brown);
-  RConsole::Canvas::Draw(intensity[0], x + 2, y + 0, brown);
-  RConsole::Canvas::Draw(intensity[0], x + 3, y + 0, brown);
-  RConsole::Canvas::Draw(intensity[0], x + 4, y + 0, brown);
-  RConsole::Canvas::Draw(intensity[0], x + 5, y + 0, brown);
-  RConsole::Canvas::Draw(intensity[0], x + 6, y + 0, brown);
-  RConsole::Canvas::Draw(intensity[0], x + 7, y + 0, brown);
-  RConsole::Canvas::Draw(intensity[0], x + 8, y + 0, brown);
-  RConsole::Canvas::Draw(intensity[0], x + 9, y + 0, brown);
-  RConsole::Canvas::Draw(intensity[0], x + 10, y + 0, brown);
-  RConsole::Canvas::Draw(intensity[2], x + 11, y + 0, brown);
-  RConsole::Canvas::Draw(intensity[2], x + 12, y + 0, brown);
-
-  RConsole::Canvas::Draw(intensity[0], x + 0, y + 1, brown);
-  RConsole::Canvas::Draw(intensity[1], x + 1, y + 1, brown);
-  RConsole::Canvas::Draw(intensity[1], x + 2, y + 1, brown);
-  RConsole::Canvas::Draw(intensity[1], x + 3, y + 1, brown);
-  RConsole::Canvas::Draw(intensity[1], x + 4, y + 1, brown);
-  RConsole::Canvas::Draw(intensity[1], x + 5, y + 1, brown);
-  RConsole::Canvas::Draw(intensity[1], x + 6, y + 1, brown);
-  RConsole::Canvas::Draw(intensity[1], x + 7, y + 1, brown);
-  RConsole::Canvas::Draw(intensity[1], x + 8, y + 1, brown);
-  RConsole::Canvas::Draw(intensity[1], x + 9, y + 1, brown);
-  RConsole::Canvas::Draw(intensity[2], x + 10, y + 1, brown);
-  RConsole::Canvas::Draw(intensity[1], x + 11, y + 1, yellow);
-  RConsole::Canvas::Draw(intensity[1], x + 12, y + 1, yellow);
-  RConsole::Canvas::Draw(intensity[2], x + 13, y + 1, brown);
-
-  RConsole::Canvas::Draw(intensity[1], x + 0, y + 2, brown);
-  RConsole::Canvas::Draw(intensity[1], x + 1, y + 2, brown);
-  RConsole::Canvas::Draw(intensity[1], x + 2, y + 2, brown);
-  RConsole::Canvas::Draw(intensity[1], x + 3, y + 2, brown);
-  RConsole::Canvas::Draw(intensity[1], x + 4, y + 2, brown);
-  RConsole::Canvas::Draw(intensity[1], x + 5, y + 2, brown);
-  RConsole::Canvas::Draw(intensity[1], x + 6, y + 2, brown);
-  RConsole::Canvas::Draw(intensity[1], x + 7, y + 2, brown);
-  RConsole::Canvas::Draw(intensity[1], x + 8, y + 2, brown);
-  RConsole::Canvas::Draw(intensity[3], x + 9, y + 2, brown);
-  RConsole::Canvas::Draw(intensity[1], x + 10, y + 2, yellow);
-  RConsole::Canvas::Draw(intensity[1], x + 11, y + 2, yellow);
-  RConsole::Canvas::Draw(intensity[0], x + 12, y + 2, yellow);
-  RConsole::Canvas::Draw(intensity[2], x + 13, y + 2, brown);
-
-  RConsole::Canvas::Draw(intensity[1], x + 0, y + 3, brown);
-  RConsole::Canvas::Draw(intensity[1], x + 1, y + 3, brown);
-  RConsole::Canvas::Draw(intensity[2], x + 2, y + 3, brown);
-  RConsole::Canvas::Draw(intensity[2], x + 3, y + 3, brown);
-  RConsole::Canvas::Draw(intensity[2], x + 4, y + 3, brown);
-  RConsole::Canvas::Draw(intensity[2], x + 5, y + 3, brown);
-  RConsole::Canvas::Draw(intensity[2], x + 6, y + 3, brown);
-  RConsole::Canvas::Draw(intensity[2], x + 7, y + 3, brown);
-  RConsole::Canvas::Draw(intensity[2], x + 8, y + 3, brown);
-  RConsole::Canvas::Draw(intensity[2], x + 9, y + 3, brown);
-  RConsole::Canvas::Draw(intensity[1], x + 10, y + 3, yellow);
-  RConsole::Canvas::Draw(intensity[2], x + 11, y + 3, yellow);
-  RConsole::Canvas::Draw(intensity[1], x + 12, y + 3, yellow);
-  RConsole::Canvas::Draw(intensity[2], x + 13, y + 3, brown);
-
-  RConsole::Canvas::Draw(intensity[3], x + 1, y + 4, grey);
-  RConsole::Canvas::Draw(intensity[3], x + 2, y + 4, grey);
-  RConsole::Canvas::Draw(intensity[3], x + 3, y + 4, grey);
-  RConsole::Canvas::Draw(intensity[3], x + 4, y + 4, grey);
-  RConsole::Canvas::Draw(intensity[3], x + 5, y + 4, grey);
-  RConsole::Canvas::Draw(intensity[3], x + 6, y + 4, grey);
-  RConsole::Canvas::Draw(intensity[3], x + 7, y + 4, grey);
-  RConsole::Canvas::Draw(intensity[3], x + 8, y + 4, grey);
-  RConsole::Canvas::Draw(intensity[3], x + 9, y + 4, brown);
-  RConsole::Canvas::Draw(intensity[3], x + 10, y + 4, brown);
-  RConsole::Canvas::Draw(intensity[2], x + 11, y + 4, yellow);
-  RConsole::Canvas::Draw(intensity[1], x + 12, y + 4, brown);
+  RConsole::Canvas::DrawSprite(backgroundLog, windowWidth / 2 - (14 / 2), windowHeight - 5);
 }
 
 /// <summary>
-/// Draws a log intended for the foreground, pixel by pixel!
+/// Draws a log intended for the foreground, a row at a time.
 /// </summary>
 void DrawForegroundLog()
 {
-  const unsigned char intensity[]
-  {
-    static_cast<unsigned char>(219),
-    static_cast<unsigned char>(178),
-    static_cast<unsigned char>(177),
-    static_cast<unsigned char>(176)
-  };
-
   // Image is 9x7
-  const int x = windowWidth / 2 - (9 / 2);
-  const int y = windowHeight - 7;
-
-  RConsole::Color brown = RConsole::Color::BROWN;
-  RConsole::Color yellow = RConsole::Color::YELLOW;
-  RConsole::Color grey = RConsole::Color::DARKGREY;
-
-  RConsole::Canvas::Draw(intensity[0], x + 6, y + 0, brown);
-  RConsole::Canvas::Draw(intensity[2], x + 7, y + 0, brown);
-
-  RConsole::Canvas::Draw(intensity[0], x + 5, y + 1, brown);
-  RConsole::Canvas::Draw(intensity[1], x + 6, y + 1, brown);
-  RConsole::Canvas::Draw(intensity[1], x + 7, y + 1, brown);
-  RConsole::Canvas::Draw(intensity[2], x + 8, y + 1, brown);
-
-  RConsole::Canvas::Draw(intensity[0], x + 3, y + 2, brown);
-  RConsole::Canvas::Draw(intensity[0], x + 4, y + 2, brown);
-  RConsole::Canvas::Draw(intensity[1], x + 5, y + 2, brown);
-  RConsole::Canvas::Draw(intensity[1], x + 6, y + 2, brown);
-  RConsole::Canvas::Draw(intensity[2], x + 7, y + 2, brown);
-  RConsole::Canvas::Draw(intensity[3], x + 8, y + 2, brown);
-
-  RConsole::Canvas::Draw(intensity[0], x + 2, y + 3, brown);
-  RConsole::Canvas::Draw(intensity[1], x + 3, y + 3, brown);
-  RConsole::Canvas::Draw(intensity[1], x + 4, y + 3, brown);
-  RConsole::Canvas::Draw(intensity[1], x + 5, y + 3, brown);
-  RConsole::Canvas::Draw(intensity[2], x + 6, y + 3, brown);
-  RConsole::Canvas::Draw(intensity[3], x + 7, y + 3, brown);
-
-  RConsole::Canvas::Draw(intensity[0], x + 1, y + 4, brown);
-  RConsole::Canvas::Draw(intensity[1], x + 2, y + 4, brown);
-  RConsole::Canvas::Draw(intensity[1], x + 3, y + 4, brown);
-  RConsole::Canvas::Draw(intensity[2], x + 4, y + 4, brown);
-  RConsole::Canvas::Draw(intensity[2], x + 5, y + 4, brown);
-  RConsole::Canvas::Draw(intensity[3], x + 6, y + 4, brown);
-
-  RConsole::Canvas::Draw(intensity[2], x + 0, y + 5, brown);
-  RConsole::Canvas::Draw(intensity[0], x + 1, y + 5, yellow);
-  RConsole::Canvas::Draw(intensity[1], x + 2, y + 5, yellow);
-  RConsole::Canvas::Draw(intensity[2], x + 3, y + 5, brown);
-  RConsole::Canvas::Draw(intensity[3], x + 4, y + 5, brown);
-  RConsole::Canvas::Draw(intensity[3], x + 5, y + 5, brown);
-
-  RConsole::Canvas::Draw(intensity[2], x + 0, y + 6, brown);
-  RConsole::Canvas::Draw(intensity[2], x + 1, y + 6, yellow);
-  RConsole::Canvas::Draw(intensity[1], x + 2, y + 6, yellow);
-  RConsole::Canvas::Draw(intensity[3], x + 3, y + 6, brown);
-  RConsole::Canvas::Draw(intensity[3], x + 4, y + 6, grey);
+  RConsole::Canvas::DrawSprite(foregroundLog, windowWidth / 2 - (9 / 2), windowHeight - 7);
 }
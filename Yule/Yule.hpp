@@ -2,6 +2,9 @@
 #include "console-utils.hpp"
 #include "ParticleSystem.hpp"
 #include "console-input.h"
+#include "FramePacer.hpp"
+#include "FrameProfiler.hpp"
+#include "PointBatch.hpp"
 
 // Please god i must be able to make this shorter
 typedef std::chrono::steady_clock::time_point Timepoint;
@@ -21,32 +24,86 @@ public:
   { }
 };
 
+/// <summary>
+/// Settings that can be changed from the command line.
+/// </summary>
+struct YuleSettings
+{
+public:
+  double simHz;                  // Fixed simulation steps per second
+  double renderHz;               // Target frames drawn per second. The pacer may drop below this, never above.
+  unsigned long frames;          // Frames to draw before exiting, 0 to run until closed. Nonzero runs deterministically.
+  double dt;                     // Seconds each frame of a deterministic run moves time forward by
+  unsigned int seed;             // Seed for particle randomness
+  RConsole::OutputTarget target; // Where frames go
+  std::string outputPath;        // File frames are written to, for TARGET_FILE
+  int width;                     // Canvas size, 0 to follow the terminal
+  int height;
+  bool isFixedSize;              // If the canvas ignores terminal resizes
+
+  YuleSettings();
+};
+
+/// <summary>
+/// Stages of a frame timed for the profiler overlay, in the order they're shown.
+/// </summary>
+enum ProfileStage
+{
+  PROFILE_INPUT,
+  PROFILE_FLAME_UPDATE,   // Per simulation step
+  PROFILE_FILE_UPDATE,    // Per simulation step
+  PROFILE_DIFF,           // Canvas::Update, split into the stages Canvas times itself
+  PROFILE_CLEAR_PREVIOUS,
+  PROFILE_WRITE_RASTER,
+  PROFILE_COPY,
+  PROFILE_DRAW_STATIC,    // Only does anything on frames the logs or burn count change
+  PROFILE_DRAW_FLAME,
+  PROFILE_DRAW_FILE,
+  PROFILE_DRAW_UI,
+  PROFILE_WORK,           // Everything between waking up and going back to sleep
+  PROFILE_COUNT
+};
+
 // Defines be here
-#define CONSOLE_WIDTH (rlutil::tcols() - 1)
-#define CONSOLE_HEIGHT (rlutil::trows())
+#define CONSOLE_WIDTH (static_cast<int>(RConsole::TerminalSize::GetColumns()) - 1)
+#define CONSOLE_HEIGHT (static_cast<int>(RConsole::TerminalSize::GetRows()))
+#define PARTICLE_GRAVITY (-5.0) // Vertical acceleration on every particle, handled by the integration kernel
+#define DEFAULT_SIM_HZ (120.0)   // Plenty for particles that live a few seconds
+#define DEFAULT_RENDER_HZ (30.0) // Smooth enough for fire, and cheap to leave running
+#define HEADLESS_WIDTH (80)      // Canvas size when drawing headless without --size
+#define HEADLESS_HEIGHT (25)
+#define DEFAULT_SEED (1)         // Particle seed when --seed isn't given
+#if defined(_WIN32)
+#define NULL_DEVICE "NUL"
+#else
+#define NULL_DEVICE "/dev/null"
+#endif
 
 // Function signature declarations
+YuleSettings ParseArguments(int argc, char* argv[]);
 void ProcessInputChar(char key);
 void ProcessInputString(std::string path);
 void ResizeIfNeeded();
 void Clear();
-
-bool TryRecyclePath(std::string path);
+void ReportRun(unsigned long frames, double seconds, size_t bytes);
 
 void TryUpdate(ParticleSystem<ParticleData>* particle_system, const double& dt);
 void TryUpdate(ParticleSystem<ParticleData>& particle_system, const double& dt);
 
-void DrawParticles(ParticleSystem<ParticleData>& particle_system);
-void DrawParticles(ParticleSystem<ParticleData>* particle_system);
+void DrawParticles(const ParticleSystem<ParticleData>& particle_system, double lead = 0);
+void DrawParticles(const ParticleSystem<ParticleData>* particle_system, double lead = 0);
 
-void HandlePendingScrapedData(ParticleSystem<ParticleData>*& scrapeSys, ParticleData& data, const double& lastFrameS);
-RConsole::Color DetermineColor(Particle<ParticleData> p);
-void CreateParticle(Particle<ParticleData>& p);
-void CreateFileParticle(Particle<ParticleData>& p);
-void UpdateParticle(double dt, Particle<ParticleData>& p);
+void HandlePendingScrapedData(ParticleSystem<ParticleData>*& scrapeSys, ParticleData& data, ParticleRandom& seeds, const double& lastFrameS);
+RConsole::Color DetermineColor(const ConstParticleRef<ParticleData>& p);
+void CreateParticle(Particle<ParticleData>& p, ParticleRandom& random);
+void CreateFileParticle(Particle<ParticleData>& p, ParticleRandom& random);
 
-void DrawFrameTime(bool is_displaying);
+void SetupProfiler();
+void RecordCanvasStages();
+void DrawProfiler(bool is_displaying);
 void DrawColorDisplay(bool is_displaying);
 void DrawBurnCount(bool is_displaying);
+void LoadSprites();
+void RedrawStaticLayers();
 void DrawForegroundLog();
 void DrawBackgroundLog();
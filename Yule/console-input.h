@@ -15,12 +15,17 @@ Depending on C vs C++ usage, either the InputParser class will be
 available for C++, or for C there is a HandleInput method. All take
 callbacks to functions, passing the input as acquired.
 
+On linux, the terminal is switched to raw non-blocking input the first
+time input is checked, and switched back at exit or on a fatal signal.
+Everything waiting is read in one go and handed out from a buffer.
+
 @copyright (See LICENSE.md)
 ************************************************************************/
+#pragma once
+
 // Ease of use OS specific defines for compiling
 #if defined(_WIN32) || defined(WIN32) || defined(WINDOWS) || defined(_WIN32_)
 #define OS_WINDOWS
-#pragma once
 #else
 #define OS_NON_WINDOWS
 #endif
@@ -30,6 +35,15 @@ callbacks to functions, passing the input as acquired.
 #define LANGUAGE_C
 #endif
 
+// Functions here are defined in the header. C++ shares one copy (and one
+// input state) across every file; C gets a copy per file, since a plain
+// inline function in C has no definition to link against.
+#ifdef LANGUAGE_CPP
+#define CI_INLINE inline
+#else
+#define CI_INLINE static inline
+#endif
+
 
 
 /////////////////////
@@ -101,11 +115,16 @@ callbacks to functions, passing the input as acquired.
 // Checks to see if a key was hit in the terminal.
 // Returns truthy if a change was detected in the input
 // queue (if a key was hit), falsy if not.
-inline int KeyHit(void);
+CI_INLINE int KeyHit(void);
 
 // Gets the last character changed in the terminal.
 // Returns the value of the last character changed.
-inline int GetChar(void);
+CI_INLINE int GetChar(void);
+
+// Reads what's waiting in the input queue, up to size characters, without
+// blocking. Returns how many characters were read; fewer than size means
+// the queue is empty.
+CI_INLINE int ReadPending(char *buffer, int size);
 
 
 
@@ -120,13 +139,230 @@ inline int GetChar(void);
 
 
 // standard kbhit, returns if character change is queued.
-inline int KeyHit(void) { return _kbhit(); }
+CI_INLINE int KeyHit(void) { return _kbhit(); }
 
 // Uses getch as a sandard, supporting commonly typed console characters.
 // Use wch to handle additional cases if you wish, tho know it changes codes.
-inline int GetChar(void) { return _getch(); }
+CI_INLINE int GetChar(void) { return _getch(); }
+
+
+// Pulls from the same queue as _kbhit/_getch, so there's no batching
+// to be had here. Just drains what's waiting.
+CI_INLINE int ReadPending(char *buffer, int size)
+{
+  int count = 0;
+  while (count < size && _kbhit())
+    buffer[count++] = (char)_getch();
+
+  return count;
+}
+
+#endif // OS_WINDOWS
+
+
+
+
+
+////////////////////////////////
+// Non-Windows Implementation //
+////////////////////////////////
+#ifdef OS_NON_WINDOWS
+
+// Strict C (-std=c99) hides the POSIX half of the system headers unless
+// asked for it. Only takes if nothing was included before this header.
+#if !defined(_POSIX_C_SOURCE) && !defined(_GNU_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+// System includes
+#include <sys/types.h>
+#include <stdio.h>    // EOF
+#include <stdlib.h>   // atexit
+#include <string.h>   // memcpy
+#include <signal.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+
+// Input state. Raw mode is set up once and then left alone; reads land
+// in buffer and get handed out from begin to end.
+struct ci_internal_input_
+{
+  int isSetUp;          // Settings saved, restore hooks installed
+  int isRaw;            // Currently in raw mode
+  int isTerminal;       // If stdin is a terminal, and so has settings to touch
+  struct termios saved; // Terminal settings from before raw mode
+  char buffer[4096];    // Read in, not yet handed out
+  int begin;
+  int end;
+};
+
+CI_INLINE struct ci_internal_input_ *ci_internal_input(void)
+{
+  static struct ci_internal_input_ input; // Zero initialized
+  return &input;
+}
+
+
+// Puts the terminal back how it was found. Safe to call more than once,
+// and from a signal handler.
+CI_INLINE void RestoreInput(void)
+{
+  struct ci_internal_input_ *input = ci_internal_input();
+  if (input->isRaw && input->isTerminal)
+    tcsetattr(STDIN_FILENO, TCSANOW, &input->saved);
+
+  input->isRaw = 0;
+}
+
+CI_INLINE void EnableRawInput(void);
+
+// Restores the terminal on the way out of a fatal signal, then lets the
+// signal do what it would have. Stopping (ctrl+z) hands the terminal back
+// while stopped and takes it again once continued.
+CI_INLINE void ci_internal_on_signal(int signalNum)
+{
+  // Recall: Define variables at the top for C
+  sigset_t stop;
+
+  RestoreInput();
+  signal(signalNum, SIG_DFL);
+  raise(signalNum);
+
+  if (signalNum == SIGTSTP)
+  {
+    // The signal is blocked while its handler runs, so the raise above is
+    // only pending. Unblocking it stops the process right here; once
+    // continued, put the handler and raw mode back.
+    sigemptyset(&stop);
+    sigaddset(&stop, SIGTSTP);
+    sigprocmask(SIG_UNBLOCK, &stop, NULL);
+
+    signal(SIGTSTP, ci_internal_on_signal);
+    EnableRawInput();
+  }
+}
+
+// termios reference: http://man7.org/linux/man-pages/man3/termios.3.html
+// More readable termios reference: https://www.mkssoftware.com/docs/man5/struct_termios.5.asp
+// Switches the terminal to raw input: no line buffering, no echo, and
+// reads that return right away with whatever is waiting (VMIN/VTIME 0).
+// Signals (ctrl+c) still work. Hooks restoring it are installed the
+// first time, only over signals nobody else handles.
+CI_INLINE void EnableRawInput(void)
+{
+  // Recall: Define variables at the top for C
+  struct ci_internal_input_ *input = ci_internal_input();
+  const int signals[] = { SIGHUP, SIGINT, SIGQUIT, SIGTERM, SIGTSTP };
+  struct sigaction current;
+  struct termios raw;
+  unsigned int i;
+
+  if (input->isRaw)
+    return;
+
+  if (!input->isSetUp)
+  {
+    input->isSetUp = 1;
+    input->isTerminal = isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &input->saved) == 0;
+    if (!input->isTerminal)
+      return;
+
+    atexit(RestoreInput);
+    for (i = 0; i < sizeof(signals) / sizeof(signals[0]); ++i)
+      if (sigaction(signals[i], NULL, &current) == 0 && current.sa_handler == SIG_DFL)
+        signal(signals[i], ci_internal_on_signal);
+  }
+
+  if (!input->isTerminal)
+    return;
+
+  raw = input->saved;
+  raw.c_lflag &= ~(ICANON | ECHO);
+  raw.c_cc[VMIN] = 0;
+  raw.c_cc[VTIME] = 0;
+  if (tcsetattr(STDIN_FILENO, TCSANOW, &raw) == 0)
+    input->isRaw = 1;
+}
+
+// Makes sure there's buffered input if any is waiting, reading it all
+// in with one read. Returns how much is buffered.
+CI_INLINE int ci_internal_fill(void)
+{
+  // Recall: Define variables at the top for C
+  struct ci_internal_input_ *input = ci_internal_input();
+  struct pollfd fd;
+  ssize_t count;
 
+  if (input->begin < input->end)
+    return input->end - input->begin;
 
+  EnableRawInput();
+  input->begin = 0;
+  input->end = 0;
+
+  // A raw terminal never blocks on read. Anything else (a pipe, a file)
+  // might, so check it has something first.
+  if (!input->isRaw)
+  {
+    fd.fd = STDIN_FILENO;
+    fd.events = POLLIN;
+    fd.revents = 0;
+    if (poll(&fd, 1, 0) <= 0 || !(fd.revents & POLLIN))
+      return 0;
+  }
+
+  count = read(STDIN_FILENO, input->buffer, sizeof(input->buffer));
+  if (count > 0)
+    input->end = (int)count;
+
+  return input->end;
+}
+
+// Returns how many characters are waiting. Only touches the terminal
+// when everything read so far has been handed out.
+CI_INLINE int KeyHit(void)
+{
+  return ci_internal_fill();
+}
+
+// Hands out the next waiting character. If called without a character
+// waiting for reading, you should recieve EOF.
+CI_INLINE int GetChar(void)
+{
+  struct ci_internal_input_ *input = ci_internal_input();
+  if (ci_internal_fill() == 0)
+    return EOF;
+
+  return (unsigned char)input->buffer[input->begin++];
+}
+
+// Copies out as much waiting input as fits. Costs at most one read, so
+// a short count means nothing else is waiting right now.
+CI_INLINE int ReadPending(char *buffer, int size)
+{
+  // Recall: Define variables at the top for C
+  struct ci_internal_input_ *input = ci_internal_input();
+  int count = ci_internal_fill();
+
+  if (count > size)
+    count = size;
+
+  memcpy(buffer, input->buffer + input->begin, count);
+  input->begin += count;
+  return count;
+}
+
+#endif // OS_NON_WINDOWS
+
+
+
+
+
+/////////////////////////////
+// Shared Parser Utilities //
+/////////////////////////////
 // C++ Specific additional functionality
 #ifdef LANGUAGE_CPP
 #include <string>     // std::string
@@ -140,12 +376,7 @@ public:
   // references as inputs for keeping track of keypresses.
   void HandleInput(std::function<void(char)> callbackSingleChar, std::function<void(std::string) > callbackMultiChar)
   {
-    while (KeyHit())
-    {
-      int character = GetChar();
-      if (character != NoInput)
-        buffer_ += character;
-    }
+    readPending();
 
     if (buffer_.size() > 0)
     {
@@ -162,12 +393,7 @@ public:
   // Uses the same variables as the other HandleInput function.
   template <class T> void HandleInput(T *thisClass, void(T::*callbackSingleChar)(char), void(T::*callbackMultiChar)(std::string))
   {
-    while (KeyHit())
-    {
-      int character = GetChar();
-      if (character != NoInput)
-        buffer_ += character;
-    }
+    readPending();
 
     if (buffer_.size() > 0)
     {
@@ -182,6 +408,24 @@ public:
 
 
 private:
+  // Pulls in everything waiting, a chunk at a time.
+  void readPending()
+  {
+    char chunk[256];
+    int count;
+    while ((count = ReadPending(chunk, sizeof(chunk))) > 0)
+    {
+      for (int i = 0; i < count; ++i)
+      {
+        if (chunk[i] != NoInput)
+          buffer_ += chunk[i];
+      }
+
+      if (count < static_cast<int>(sizeof(chunk)))
+        break;
+    }
+  }
+
   // Variables
   const int NoInput = 0;    // A constant for defining a lack of input. 
   std::string buffer_ = ""; // So long as we recieve input without a break, we continue to store it here.
@@ -191,12 +435,13 @@ private:
 
 // Additional functionality for C
 #ifdef LANGUAGE_C
+#include <string.h> // memset
 
 // Global internal variables for C
 int ci_internal_last_char_ = 0;
 int ci_internal_buffer_pos_ = 0;
-const int buffer_max = 255;
-char ci_internal_buffer_[buffer_max] = {};
+enum { buffer_max = 255 };
+char ci_internal_buffer_[buffer_max];
 
 // Callback functions specified as necessary.
 void HandleInput(void(callbackSingleChar)(char), void(callbackFilepath)(const char *, int))
@@ -209,12 +454,10 @@ void HandleInput(void(callbackSingleChar)(char), void(callbackFilepath)(const ch
     do
     {
       ci_internal_last_char_ = GetChar();
-      ci_internal_buffer_[ci_internal_buffer_pos_] = (char)ci_internal_last_char_;
-
       if (ci_internal_buffer_pos_ < buffer_max)
-        ++ci_internal_buffer_pos_;
+        ci_internal_buffer_[ci_internal_buffer_pos_++] = (char)ci_internal_last_char_;
 
-    } while (hit = KeyHit());
+    } while ((hit = KeyHit()));
 
   // If there is currently not a hit key but there was one 
   // last cycle when we checked...
@@ -232,86 +475,3 @@ void HandleInput(void(callbackSingleChar)(char), void(callbackFilepath)(const ch
     }
 }
 #endif // LANGUAGE_C
-#endif // OS_WINDOWS
-
-
-
-
-
-////////////////////////////////
-// Non-Windows Implementation //
-////////////////////////////////
-#ifdef OS_NON_WINDOWS
-
-// System includes, mostly kbhit emulation
-#include <sys/ioctl.h>
-#include <sys/types.h>
-#include <sys/time.h>
-
-// GetCH emulation + time
-#include <stdio.h>
-#include <termios.h>
-#include <unistd.h>
-
-
-
-// termios reference: http://man7.org/linux/man-pages/man3/termios.3.html
-// More readable termios reference: https://www.mkssoftware.com/docs/man5/struct_termios.5.asp
-// select reference: http://man7.org/linux/man-pages/man2/select.2.html
-inline int KeyHit(void)
-{
-  // Recall: Define variables at the top for C
-  static struct termios oldTermios; // Save off for previous terminal settings
-  static struct termios newTermios; // Configured new terminal settings
-  struct timeval tv;                // Timeval struct for small delays.
-  int charCount = 0;                // Character count
-
-  // Set up the console.
-  tcgetattr(STDIN_FILENO, &oldTermios);           // Get old settings
-  newTermios = oldTermios;                        // Transfer previous settings
-  newTermios.c_oflag = 0;                         // Output mode
-  newTermios.c_lflag &= ~(ICANON | ECHO);         // Jupt straight to the queue and don't echo.
-  newTermios.c_iflag = 0;                         // Input mode
-  newTermios.c_cc[VMIN] = 1;                      // Minimum time to wait
-  newTermios.c_cc[VTIME] = 1;                     // Minimum characters to wait for
-  tcsetattr(STDIN_FILENO, TCSANOW, &newTermios);  // Set newTermios
-
-  // Not checking return values, because if you're having issues with 
-  // accessing the stack or reading information from the stream, you
-  // likely have bigger issues than this function not working.
-  ioctl(0, FIONREAD, &charCount);
-
-  // Check file stream with a small delay, then return to previous state.
-  tv.tv_sec = 0;     // time to delay, in Seconds.
-  tv.tv_usec = 100;  // time to delay, in Microseconds
-  select(STDIN_FILENO + 1, NULL, NULL, NULL, &tv);
-  tcsetattr(STDIN_FILENO, TCSANOW, &oldTermios);
-  return charCount;
-}
-
-// Makes use of the getchar function. Effectively getc(stdin), 
-// with quick tweaks to the terminal to prevent oops.
-// getchar documentation: https://linux.die.net/man/3/getchar
-// If called without a character waiting for reading, 
-// you should recieve EOF.
-inline int GetChar(void)
-{
-  // Recall: Define variables at the top for C
-  struct termios oldTermios; // Save off for previous terminal settings
-  struct termios newTermios; // Configured new terminal settings
-  int charVal;               // The key value (as int) from stream.
-
-  // Configure newTermios
-  tcgetattr(STDIN_FILENO, &oldTermios);
-  newTermios = oldTermios;
-  newTermios.c_lflag &= ~(ICANON | ECHO);
-  tcsetattr(STDIN_FILENO, TCSANOW, &newTermios);
-
-  // Reset terminal and return
-  charVal = getchar();
-  tcsetattr(STDIN_FILENO, TCSANOW, &oldTermios);
-  return charVal;
-}
-
-#endif // OS_NON_WINDOWS
-
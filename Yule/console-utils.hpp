@@ -362,11 +362,13 @@ RLUTIL_INLINE int trows(void) {
 #else
 #ifdef TIOCGSIZE
 	struct ttysize ts;
-	ioctl(STDIN_FILENO, TIOCGSIZE, &ts);
+	if (ioctl(STDIN_FILENO, TIOCGSIZE, &ts) != 0)
+		return -1;
 	return ts.ts_lines;
 #elif defined(TIOCGWINSZ)
 	struct winsize ts;
-	ioctl(STDIN_FILENO, TIOCGWINSZ, &ts);
+	if (ioctl(STDIN_FILENO, TIOCGWINSZ, &ts) != 0)
+		return -1;
 	return ts.ws_row;
 #else // TIOCGSIZE
 	return -1;
@@ -387,11 +389,13 @@ RLUTIL_INLINE int tcols(void) {
 #else
 #ifdef TIOCGSIZE
 	struct ttysize ts;
-	ioctl(STDIN_FILENO, TIOCGSIZE, &ts);
+	if (ioctl(STDIN_FILENO, TIOCGSIZE, &ts) != 0)
+		return -1;
 	return ts.ts_cols;
 #elif defined(TIOCGWINSZ)
 	struct winsize ts;
-	ioctl(STDIN_FILENO, TIOCGWINSZ, &ts);
+	if (ioctl(STDIN_FILENO, TIOCGWINSZ, &ts) != 0)
+		return -1;
 	return ts.ws_col;
 #else // TIOCGSIZE
 	return -1;
@@ -486,6 +490,8 @@ namespace RConsole
 ///////////////////////////////////////////////////////////////////////
 //Field2D.hpp
 ///////////////////////////////////////////////////////////////////////
+#include <utility>          // std::swap
+#include <algorithm>        // std::copy for resizing in place
 
 // For strict unused variable warnings.
 #define UNUSED(x) (void)(x)
@@ -523,7 +529,7 @@ namespace RConsole
 /////// CONSOLE SETTINGS /////////
 
 #define RConsole_CLIP_CONSOLE // Define we want console clipping
-#define RConsole_NO_THREADING // Define we aren't threading- printf becomes unsafe, but faster.
+//#define RConsole_NO_THREADING // Define to compile out the render thread- printf becomes unsafe, but faster.
 
 
 #ifdef COMPILER_VS
@@ -606,14 +612,18 @@ namespace RConsole
     Field2D &operator=(const Field2D &rhs);
     Field2D(const Field2D &rhs);
     ~Field2D();
+    void Swap(Field2D &rhs);
+    void Resize(unsigned int w, unsigned int h);
 
 	  // Structure Info
 	  unsigned int Width() const;
 	  unsigned int Height() const;
     unsigned int Length() const;
+    unsigned int Capacity() const;
 
     // Member Functions - Complex Manipulation
     void Zero();
+    void Zero(unsigned int begin, unsigned int count);
     void Set(const T &newItem);
     T &Get(unsigned int x, unsigned int y);
     Field2DProxy<T> operator[](unsigned int xPos);
@@ -627,6 +637,7 @@ namespace RConsole
     // Basic Manipulation
     T &Get();
     T* GetHead() { return data_;}
+    const T* GetHead() const { return data_;}
     const T &Get() const;
     void IncrementX();
     void IncrementY();
@@ -640,6 +651,7 @@ namespace RConsole
     unsigned int index_;
     unsigned int width_;
     unsigned int height_;
+    unsigned int capacity_; // Cells allocated, at least width_ * height_
     T *data_;
   };
 }
@@ -690,6 +702,13 @@ namespace RConsole
     return width_ * height_;
   }
 
+  // Gets how many cells fit without reallocating
+  template <typename T>
+  inline unsigned int Field2D<T>::Capacity() const
+  {
+    return capacity_;
+  }
+
 
     /////////////////////////////
    // Field2D Methods and Co. //
@@ -701,6 +720,7 @@ namespace RConsole
     : index_(0)
     , width_(w)
     , height_(h)
+    , capacity_(w * h)
     , data_(nullptr)
   {
     data_ = new T[w * h];
@@ -714,6 +734,7 @@ namespace RConsole
     : index_(0)
     , width_(w)
     , height_(h)
+    , capacity_(w * h)
     , data_(nullptr)
   {
     T* adsf = new T[w * h];
@@ -730,16 +751,16 @@ namespace RConsole
 
   template <typename T>
   inline Field2D<T>::Field2D(const Field2D<T> &rhs)
+    : index_(0)
+    , width_(0)
+    , height_(0)
+    , capacity_(0)
+    , data_(nullptr)
   {
-    if (data_)
-    {
-      delete[] data_;
-      data_ = nullptr;
-    }
-
     data_ = new T[rhs.width_ * rhs.height_];
     width_ = rhs.width_;
     height_ = rhs.height_;
+    capacity_ = width_ * height_;
     index_ = rhs.index_;
 
     for (unsigned int i = 0; i < width_ * height_; ++i)
@@ -761,6 +782,7 @@ namespace RConsole
       data_ = new T[rhs.width_ * rhs.height_];
       width_ = rhs.width_;
       height_ = rhs.height_;
+      capacity_ = width_ * height_;
       index_ = rhs.index_;
 
       for (unsigned int i = 0; i < width_ * height_; ++i)
@@ -780,6 +802,66 @@ namespace RConsole
   }
 
 
+  // Exchanges contents with another field by pointer, nothing is copied.
+  template <typename T>
+  inline void Field2D<T>::Swap(Field2D<T> &rhs)
+  {
+    std::swap(index_, rhs.index_);
+    std::swap(width_, rhs.width_);
+    std::swap(height_, rhs.height_);
+    std::swap(capacity_, rhs.capacity_);
+    std::swap(data_, rhs.data_);
+  }
+
+
+  // Changes dimensions, keeping the cells where the old and new sizes overlap (anchored at
+  // the top left) and zeroing the rest. Only allocates when more cells are needed than the
+  // field has room for, and then with headroom so a run of small grows (dragging a window
+  // edge) doesn't allocate every time; otherwise rows are moved around in place. Resets the index.
+  template <typename T>
+  inline void Field2D<T>::Resize(unsigned int w, unsigned int h)
+  {
+    if (w == width_ && h == height_)
+      return;
+
+    const unsigned int keepW = w < width_ ? w : width_;
+    const unsigned int keepH = h < height_ ? h : height_;
+    if (w * h > capacity_)
+    {
+      const unsigned int capacity = w * h > capacity_ + capacity_ / 2 ? w * h : capacity_ + capacity_ / 2;
+      T *data = new T[capacity];
+      for (unsigned int y = 0; y < keepH; ++y)
+        std::copy(data_ + y * width_, data_ + y * width_ + keepW, data + y * w);
+
+      delete[] data_;
+      data_ = data;
+      capacity_ = capacity;
+    }
+    else if (w < width_)
+    {
+      // Rows only move toward the front, so go top to bottom.
+      for (unsigned int y = 1; y < keepH; ++y)
+        std::copy(data_ + y * width_, data_ + y * width_ + keepW, data_ + y * w);
+    }
+    else if (w > width_)
+    {
+      // Rows only move toward the back, so go bottom to top.
+      for (unsigned int y = keepH; y-- > 1; )
+        std::copy_backward(data_ + y * width_, data_ + y * width_ + keepW, data_ + y * w + keepW);
+    }
+
+    // Everything outside the overlap starts out zeroed, like a new field.
+    if (keepW < w)
+      for (unsigned int y = 0; y < keepH; ++y)
+        Zero(y * w + keepW, w - keepW);
+    Zero(keepH * w, w * (h - keepH));
+
+    width_ = w;
+    height_ = h;
+    index_ = 0;
+  }
+
+
     ////////////////////////
    // Complex Operations //
   ////////////////////////
@@ -845,7 +927,17 @@ namespace RConsole
   template <typename T>
   inline void Field2D<T>::Zero()
   {
-    memset(data_, 0, sizeof(T) * width_ * height_);
+    Zero(0, width_ * height_);
+  }
+
+
+  // Sets count items from begin (in Get's x + y * width order) to 0. All bits clear, which
+  // isn't the same as T() for every T (RasterInfo() sets a flag), hence memset over std::fill.
+  // Does NOT modify index!
+  template <typename T>
+  inline void Field2D<T>::Zero(unsigned int begin, unsigned int count)
+  {
+    memset(static_cast<void *>(data_ + begin), 0, sizeof(T) * count);
   }
 
 
@@ -942,23 +1034,54 @@ namespace RConsole
 ///////////////////////////////////////////////////////////////////////
 //CanvasRaster.hpp
 ///////////////////////////////////////////////////////////////////////
+#include <vector>           // Per-row dirty spans.
 
 
 namespace RConsole
 {
   // The raster info struct, holds info on what is to be drawn at a location and the color.
+  // Packed into 16 bits: the glyph in the low byte, then the color, a flag for
+  // PREVIOUS_COLOR, and whether the cell was drawn to this frame. Comparison only
+  // looks at what ends up on screen, so the modified flag is ignored.
   struct RasterInfo
   {
     RasterInfo();
     RasterInfo(const char val, Color col);
     bool operator ==(const RasterInfo &rhs) const;
     bool operator !=(const RasterInfo &rhs) const;
-    char Value;
-    Color C;
+
+    // Accessors
+    char GetValue() const;
+    Color GetColor() const;
+    bool IsModified() const;
+    void SetValue(char val);
+    void SetColor(Color col);
+    void SetModified(bool isModified);
+
+    // Layout
+    static const unsigned short GlyphMask = 0x00FF;
+    static const unsigned short ColorMask = 0x0F00;
+    static const unsigned short ColorShift = 8;
+    static const unsigned short PreviousColorFlag = 0x1000;
+    static const unsigned short ModifiedFlag = 0x8000;
+    static const unsigned short CompareMask = GlyphMask | ColorMask | PreviousColorFlag;
+
+    unsigned short Bits;
+  };
+
+  // The columns [Begin, End) of one raster row that have been written to. Empty if Begin >= End.
+  struct RowSpan
+  {
+    RowSpan();
+    RowSpan(unsigned int begin, unsigned int end);
+    bool Empty() const;
+    unsigned int Begin;
+    unsigned int End;
   };
 
   // Console raster class
   class Canvas;
+  class Sprite;
   class CanvasRaster
   {
     friend Canvas;
@@ -968,11 +1091,26 @@ namespace RConsole
     CanvasRaster(unsigned int width, unsigned int height);
 
     // Method Prototypes
+    void Swap(CanvasRaster &rhs);
+    void Resize(unsigned int width, unsigned int height);
     bool WriteChar(char toDraw, float x, float y, Color color = PREVIOUS_COLOR);
 	  bool WriteString(const char *toWrite, size_t len, float x, float y, Color color = PREVIOUS_COLOR);
+    void WriteSprite(const Sprite &sprite, int x, int y);
+    void WritePoints(const float *x, const float *y, const char *glyphs, const Color *colors, size_t count);
     const Field2D<RasterInfo>& GetRasterData() const;
     void Fill(const RasterInfo &ri);
     void Zero();
+    void Restore(const Field2D<RasterInfo> &base, unsigned int generation);
+
+    // Dirty tracking
+    const RowSpan &GetRowSpan(unsigned int row) const;
+    unsigned int GetDirtyRowBegin() const;
+    unsigned int GetDirtyRowEnd() const;
+    unsigned int GetGeneration() const;
+
+    // Contents outside the spans, see GetGeneration.
+    static const unsigned int ZeroGeneration = 0;
+    static const unsigned int UnknownGeneration = ~0u;
 
     // General
     unsigned int GetRasterWidth() const;
@@ -981,12 +1119,238 @@ namespace RConsole
   private:
     // Private member functions
     Field2D<RasterInfo>& GetRasterData();
+    void markDirty(unsigned int index, size_t len);
+    void markAllDirty();
 
     // Variables
     unsigned int width_;
     unsigned int height_;
     Field2D<RasterInfo> data_;
 
+    // Everything outside these spans is the base the raster was last cleared to: zero, or
+    // a canvas's static layers. Rows [dirtyRowBegin_, dirtyRowEnd_) are the only ones that
+    // may have a non-empty span.
+    std::vector<RowSpan> spans_;
+    unsigned int dirtyRowBegin_;
+    unsigned int dirtyRowEnd_;
+    unsigned int generation_; // Which base is outside the spans
+
+    // Tuning
+    static const size_t PointChunk = 256; // Points clipped at a time by WritePoints, on the stack
+  };
+}
+
+
+///////////////////////////////////////////////////////////////////////
+//Sprite.hpp
+///////////////////////////////////////////////////////////////////////
+#include <string>           // Sprite text.
+#include <vector>           // Cells and runs.
+
+
+namespace RConsole
+{
+  // A fixed picture, compiled once into runs of opaque cells so drawing it costs one clip
+  // and a memcpy per run instead of a Draw call per cell. Loaded from text in three sections:
+  //   [legend]  Lines of "<character> <byte>", standing a typeable character in for a glyph
+  //             byte (like 219 for a full block). Other characters stand for themselves.
+  //   [glyphs]  The picture, one line per row. Spaces are transparent.
+  //   [colors]  The same shape again, with a hex digit per cell giving its Color.
+  class Sprite
+  {
+    friend CanvasRaster;
+
+  public:
+    // Constructors
+    Sprite();
+
+    // Method Prototypes
+    bool Load(const std::string &text);
+    bool LoadFile(const std::string &path);
+
+    // General
+    unsigned int GetWidth() const;
+    unsigned int GetHeight() const;
+    size_t GetRunCount() const;
+
+  private:
+    // Opaque cells [Begin, Begin + Length) of one row.
+    struct Run
+    {
+      unsigned int Row;
+      unsigned int Begin;
+      unsigned int Length;
+    };
+
+    // Variables
+    unsigned int width_;
+    unsigned int height_;
+    std::vector<RasterInfo> cells_; // width_ * height_, ready to copy straight into a raster
+    std::vector<Run> runs_;         // In row order
+  };
+}
+
+
+///////////////////////////////////////////////////////////////////////
+//FrameBuffer.hpp
+///////////////////////////////////////////////////////////////////////
+#include <vector>           // Frame byte storage.
+
+
+namespace RConsole
+{
+  // A byte buffer that a whole frame of terminal output is assembled in, so it can be
+  // handed to the terminal with a single write instead of one call per cell.
+  // Storage is kept between frames, so after the first few frames nothing is allocated.
+  class FrameBuffer
+  {
+  public:
+    // Constructors
+    FrameBuffer();
+
+    // Method Prototypes
+    void Reserve(size_t bytes);
+    void Clear();
+    void Append(char c);
+    void Append(const char *bytes, size_t len);
+    void AppendNumber(unsigned int value);
+    void AppendLocate(unsigned int x, unsigned int y);
+    void AppendCursorForward(unsigned int count);
+    void AppendColor(Color color);
+    bool Flush();
+    bool FlushTo(FILE *file);
+    void FlushTo(std::vector<char> &sink);
+
+    // General
+    const char *Data() const;
+    size_t Size() const;
+
+  private:
+    // Private member functions
+    void grow(size_t minCapacity);
+
+    // Variables
+    std::vector<char> bytes_;
+    size_t size_;
+  };
+}
+
+
+///////////////////////////////////////////////////////////////////////
+//RasterDiff.hpp
+///////////////////////////////////////////////////////////////////////
+#include "cpu-features.hpp" // Kernel selection.
+
+
+namespace RConsole
+{
+  // A run of consecutive raster cells [Begin, End), by linear index, that need to be emitted.
+  struct CellRun
+  {
+    unsigned int Begin;
+    unsigned int End;
+  };
+
+  // Compares the current and previous raster between two linear indices and writes out the
+  // runs of cells that have to be emitted this frame: cells that differ from last frame and
+  // either hold a glyph or need blanking (not drawn to this frame). Returns the run count.
+  // Runs never span more than the range given, so at most (end - begin + 1) / 2 are written.
+  namespace RasterDiff
+  {
+    typedef size_t (*FindChangesFunc)(const RasterInfo *curr, const RasterInfo *prev,
+                                      unsigned int begin, unsigned int end, CellRun *runs);
+
+    size_t FindChangesScalar(const RasterInfo *curr, const RasterInfo *prev,
+                             unsigned int begin, unsigned int end, CellRun *runs);
+    FindChangesFunc GetFindChanges(CpuFeatures::SimdLevel level);
+    FindChangesFunc GetFindChanges();
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////
+//RasterTripleBuffer.hpp
+///////////////////////////////////////////////////////////////////////
+#ifndef RConsole_NO_THREADING
+#include <atomic>           // Lock-free slot handoff.
+
+
+namespace RConsole
+{
+  // Hands finished rasters from the thread drawing them to the thread writing them out,
+  // without either one ever waiting on the other. There are three slots: one the producer
+  // owns, one the consumer owns, and one in the middle holding the latest finished frame.
+  // A frame the consumer doesn't get to before the next one is published is dropped.
+  class RasterTripleBuffer
+  {
+  public:
+    // Constructors
+    RasterTripleBuffer(unsigned int width, unsigned int height);
+
+    // Method Prototypes
+    void Reset(unsigned int width, unsigned int height);
+    void Publish(CanvasRaster &drawn);
+    bool Acquire();
+    bool HasFresh() const;
+    CanvasRaster &Front();
+    size_t GetDropped() const;
+
+  private:
+    // Variables
+    std::vector<CanvasRaster> slots_;
+    unsigned int back_;               // Producer's slot
+    unsigned int front_;              // Consumer's slot
+    std::atomic<unsigned int> middle_; // Shared slot, with FreshFlag if it holds an unread frame
+    size_t dropped_;                  // Frames replaced before the consumer got to them. Producer only.
+
+    static const unsigned int FreshFlag = 0x4;
+    static const unsigned int IndexMask = 0x3;
+  };
+}
+#endif // RConsole_NO_THREADING
+
+
+///////////////////////////////////////////////////////////////////////
+//TerminalSize.hpp
+///////////////////////////////////////////////////////////////////////
+#include <atomic>           // Resize flag set from the signal handler.
+#include <chrono>           // Refresh throttling where there's no resize signal.
+
+
+namespace RConsole
+{
+  // Cached terminal dimensions. Asking the terminal costs a syscall per question, so the
+  // size is read once and only read again after it changes. On POSIX a SIGWINCH handler
+  // marks the cached size stale and writes to a self-pipe, so a poll can wake up on resize.
+  // Windows has no resize signal, so there it's re-read at most every RefreshMilliseconds.
+  // Sizes are never below 1, even with no terminal attached.
+  class TerminalSize
+  {
+  public:
+    // Method Prototypes
+    static bool Refresh();
+    static unsigned int GetColumns();
+    static unsigned int GetRows();
+    static int GetResizeHandle();
+
+    static const unsigned int RefreshMilliseconds = 250;
+
+  private:
+    // Hidden Constructors- no instantiating publicly!
+    TerminalSize() { }
+
+    // Private methods.
+    static void watch();
+    static void query();
+    static void onResize(int signalNum);
+
+    // Variables
+    static unsigned int columns_;
+    static unsigned int rows_;
+    static std::atomic<bool> isStale_;                     // Size may have changed since the last query
+    static bool isWatching_;                               // Resize handler installed
+    static int resizePipe_[2];                             // Read end readable after a resize, -1 if unavailable
+    static std::chrono::steady_clock::time_point lastQuery_;
   };
 }
 
@@ -994,15 +1358,62 @@ namespace RConsole
 ///////////////////////////////////////////////////////////////////////
 //Canvas.hpp
 ///////////////////////////////////////////////////////////////////////
+#include <atomic>             // Frame stats read across threads.
+#include <chrono>             // Stage timings.
+#ifndef RConsole_NO_THREADING
+#include <thread>             // Render thread.
+#include <mutex>              // Render thread wakeup.
+#include <condition_variable> // Render thread wakeup.
+#ifndef _WIN32
+#include <csignal>            // Keeping close signals off the render thread.
+#endif
+#endif
 
 
 namespace RConsole
 {
+  // How a finished frame reaches the terminal.
+  enum OutputMode
+  {
+    OUTPUT_DIRECT,  // Every cursor move, color change and character is its own call (rlutil).
+    OUTPUT_BUFFERED // The frame is assembled as ANSI in one buffer and written in a single call.
+  };
+
+  // Where finished frames go. Anything but the terminal is headless: frames are always
+  // buffered, and nothing is written to the terminal at all.
+  enum OutputTarget
+  {
+    TARGET_TERMINAL, // stdout.
+    TARGET_MEMORY,   // Collected in memory, see GetCapturedOutput.
+    TARGET_FILE      // Written to a file. "/dev/null" (NUL on Windows) throws frames away.
+  };
+
+  // Parts of getting a frame out that Canvas can time, see SetProfiling.
+  enum CanvasStage
+  {
+    STAGE_DIFF,           // Finding what changed since the last frame.
+    STAGE_CLEAR_PREVIOUS, // Blanking what moved. The minimal emitter does this while writing.
+    STAGE_WRITE_RASTER,   // Writing the changes out.
+    STAGE_COPY,           // Compositing, then handing the raster off or swapping it, and clearing the next one.
+    STAGE_COUNT
+  };
+
+  // What drawing calls draw into, see SetLayer. The static layers hold what rarely changes.
+  // They're composited into a base once whenever they change, and every frame is cleared
+  // back to that base instead of to blank, so the diff only looks at what's drawn on top.
+  enum CanvasLayer
+  {
+    LAYER_BACK,    // Static, behind everything.
+    LAYER_DYNAMIC, // Redrawn every frame. The default.
+    LAYER_FRONT    // Static, in front of everything, including the dynamic layer.
+  };
+
   class Canvas
   {
   public:
     // Init call
     static void ReInit(unsigned int width, unsigned int height);
+    static void Resize(unsigned int width, unsigned int height);
 
     // Basic drawing calls
     static bool Update();
@@ -1022,38 +1433,137 @@ namespace RConsole
     // Advanced drawing calls
     static void DrawPartialPoint(float x, float y, Color color);
     static void DrawBox(char toWrite, float x1, float y1, float x2, float y2, Color color);
+    static void DrawSprite(const Sprite &sprite, int x, int y);
+    static void DrawPoints(const float *x, const float *y, const char *glyphs, const Color *colors, size_t count);
     static void SetCursorVisible(bool isVisible);
+
+    // Layer calls
+    static void SetLayer(CanvasLayer layer);
+    static CanvasLayer GetLayer();
+    static void ClearLayer(CanvasLayer layer);
     static void DumpRaster(FILE *fp = stdout);
     static void CropRaster(FILE *fp = stdout, char toTrim = ' ');
 
     // Data related calls
     static unsigned int GetConsoleWidth();
     static unsigned int GetConsoleHeight();
+
+    // Output related calls
+    static void SetOutputMode(OutputMode mode);
+    static void SetOutputMinimized(bool isMinimized);
+    static OutputMode GetOutputMode();
+    static bool SetOutputTarget(OutputTarget target, const char *path = nullptr);
+    static OutputTarget GetOutputTarget();
+    static const std::vector<char> &GetCapturedOutput();
+    static void ClearCapturedOutput();
+    static size_t GetLastFrameBytes();
+    static size_t GetDroppedFrames();
+    static size_t GetLastFrameChanges();
+    static size_t GetLastFrameScanned();
+    static void SetProfiling(bool isProfiling);
+    static long GetStageMicroseconds(CanvasStage stage);
+
+    // Pipelined output. While the render thread runs, Update only hands the finished raster
+    // off and returns; diffing and terminal writes happen on the render thread, so a slow
+    // terminal never holds up the caller. Calls that change output state pause it briefly.
+    static void StartRenderThread();
+    static void StopRenderThread();
+    static bool IsRenderThreadRunning();
   private:
     // Hidden Constructors- no instantiating publicly!
     Canvas() { };
     Canvas(const Canvas &rhs) { *this = rhs; }
     
     // Private methods.
-    static void clearPrevious();
+    static void clearPrevious(const CanvasRaster &r);
     static void fullClear();
     static void setColor(const Color &color);
-    static bool writeRaster(CanvasRaster &r);
+    static bool writeRaster(const CanvasRaster &r);
+    static void moveCursor(unsigned int x, unsigned int y);
+    static void writeFrameMinimal(const CanvasRaster &r);
+    static void emitCellMinimal(const CanvasRaster &r, unsigned int x, unsigned int y, char value, Color color);
+    static bool rewriteGap(const CanvasRaster &r, unsigned int x, unsigned int y, unsigned int length);
+    static void forgetTerminalState();
+    static void markStage(CanvasStage stage, std::chrono::steady_clock::time_point &mark);
+    static unsigned int frameRowBegin(const CanvasRaster &r);
+    static unsigned int frameRowEnd(const CanvasRaster &r);
+    static RowSpan frameSpan(const CanvasRaster &r, unsigned int row);
+    static void findChanges(const CanvasRaster &r);
+    static void presentFrame(const CanvasRaster &r);
+    static void ensureLayers();
+    static void composeLayers();
+    static void clearForDrawing(CanvasRaster &r);
+    static CanvasRaster &layerRaster(CanvasLayer layer);
+    static bool pauseRenderThread();
+    static void resumeRenderThread(bool wasRunning);
+    static void renderLoop();
+    static void wakeRenderThread();
+    static int  emitChar(char character);
     static int  putC(int character, FILE * stream );
     static void setCloseHandler();
+    static void onCloseSignal(int signalNum);
+    static void closeFromSignal();
 
-    // Any rasters we have. Could be expanded to have two, so you could "swap" them,
-    // Although practicality of that is limited given the clearing technique.
+    // Back buffer being drawn to, and front buffer with what's on screen. Without the
+    // render thread they trade places every Update; with it, finished back buffers go
+    // through pipeline_ and prev_ belongs to the render thread.
     static CanvasRaster r_;
     static CanvasRaster prev_;
 
+    // Static layers, and base_ with front composited over back. Every cell of base_ has
+    // its modified flag clear, which is how composeLayers tells it apart from what was drawn
+    // to r_ on top of it. None of this is sized until a static layer is first used.
+    static CanvasRaster backLayer_;
+    static CanvasRaster frontLayer_;
+    static Field2D<RasterInfo> base_;
+    static unsigned int generation_; // Of base_, bumped whenever it's rebuilt. Never ZeroGeneration.
+    static bool hasLayers_;          // Frames are cleared to base_ rather than to zero
+    static bool layersChanged_;      // A static layer may have been drawn to since the last compose
+    static CanvasLayer layer_;
+    static CanvasRaster *target_;    // Where drawing calls go: r_, or a static layer
+
     // The tabs on what was last modified. This is important, because we will only update
     // what we care about.
     static bool hasLazyInit_;
     static bool isDrawing_;
+    static std::atomic<int> closeSignal_; // Signal that asked to close, acted on by the next Update
     static unsigned int width_;
     static unsigned int height_;
-    static Field2D<bool> modified_;
+
+    // Output handling. In buffered mode, a frame's worth of output collects in frame_
+    // and goes out all at once at the end of Update.
+    static OutputMode outputMode_;
+    static FrameBuffer frame_;
+    static OutputTarget outputTarget_;
+    static FILE *outputFile_;           // Open while the target is TARGET_FILE
+    static std::vector<char> captured_; // Everything written while the target is TARGET_MEMORY
+    static std::atomic<size_t> lastFrameBytes_;
+    static std::atomic<size_t> lastFrameChanges_;
+    static std::atomic<size_t> lastFrameScanned_;
+    static std::atomic<bool> isProfiling_;
+    static std::atomic<long> stageMicroseconds_[STAGE_COUNT]; // Latest timing of each stage
+
+    // Where the terminal cursor is (0-based) and what color it prints in, as far as the
+    // minimal buffered emitter knows. termX_ of UINT_MAX and termColor_ of PREVIOUS_COLOR
+    // mean unknown. Only valid while nothing else writes to the terminal.
+    static bool minimizeOutput_;
+    static bool clearPending_; // Next frame starts by clearing the screen
+    static unsigned int termX_;
+    static unsigned int termY_;
+    static Color termColor_;
+
+    // Cells to emit this frame, found once per Update and shared by every output path.
+    static std::vector<CellRun> runs_;
+    static size_t runCount_;
+
+  #ifndef RConsole_NO_THREADING
+    // Render thread state.
+    static RasterTripleBuffer pipeline_;
+    static std::thread renderThread_;
+    static std::atomic<bool> isRendering_;
+    static std::mutex renderMutex_;
+    static std::condition_variable renderWake_;
+  #endif
   };
 }
 
@@ -1070,40 +1580,163 @@ namespace RConsole
   ////////////////////////
   // 
   //constructor, no character and just the previous color.
-  inline RasterInfo::RasterInfo() : Value(0), C(Color::PREVIOUS_COLOR)
+  inline RasterInfo::RasterInfo() : Bits(PreviousColorFlag)
   {  }
 
   
   // Non-Default constructor, specifies const character and color.
-  inline RasterInfo::RasterInfo(const char val, Color col) : Value(val), C(col)
-  {  }
+  inline RasterInfo::RasterInfo(const char val, Color col) : Bits(0)
+  {
+    SetValue(val);
+    SetColor(col);
+  }
 
 
-  // Overloaded comparision operator that checks all fields.
+  // Overloaded comparision operator that checks the glyph and color.
   inline bool RasterInfo::operator ==(const RasterInfo &rhs) const
   {
-    if (rhs.C == C && rhs.Value == Value)
-      return true;
-    return false;
+    return ((rhs.Bits ^ Bits) & CompareMask) == 0;
   }
 
 
-  // Overloaded comparison operator that checks all fields.
+  // Overloaded comparison operator that checks the glyph and color.
   inline bool RasterInfo::operator !=(const RasterInfo &rhs) const
   {
     return !(*this == rhs);
   }
 
 
+  // Character to draw, 0 for nothing.
+  inline char RasterInfo::GetValue() const
+  {
+    return static_cast<char>(Bits & GlyphMask);
+  }
+
+
+  // Color to draw in. Anything past the 16 console colors reads back as PREVIOUS_COLOR.
+  inline Color RasterInfo::GetColor() const
+  {
+    if (Bits & PreviousColorFlag)
+      return PREVIOUS_COLOR;
+    return static_cast<Color>((Bits & ColorMask) >> ColorShift);
+  }
+
+
+  // If the cell has been drawn to since the raster was last zeroed.
+  inline bool RasterInfo::IsModified() const
+  {
+    return (Bits & ModifiedFlag) != 0;
+  }
+
+
+  // Sets the character to draw.
+  inline void RasterInfo::SetValue(char val)
+  {
+    Bits = static_cast<unsigned short>((Bits & ~GlyphMask) | static_cast<unsigned char>(val));
+  }
+
+
+  // Sets the color to draw in.
+  inline void RasterInfo::SetColor(Color col)
+  {
+    Bits &= static_cast<unsigned short>(~(ColorMask | PreviousColorFlag));
+    if (col < BLACK || col >= PREVIOUS_COLOR)
+      Bits |= PreviousColorFlag;
+    else
+      Bits |= static_cast<unsigned short>(col << ColorShift);
+  }
+
+
+  // Marks the cell as drawn to, or not.
+  inline void RasterInfo::SetModified(bool isModified)
+  {
+    if (isModified)
+      Bits |= ModifiedFlag;
+    else
+      Bits &= static_cast<unsigned short>(~ModifiedFlag);
+  }
+
+
+    //////////////
+   // Row span //
+  //////////////
+  // Default constructor, nothing dirty.
+  inline RowSpan::RowSpan() : Begin(0), End(0)
+  {  }
+
+
+  // Non-Default constructor, specifies the column range.
+  inline RowSpan::RowSpan(unsigned int begin, unsigned int end) : Begin(begin), End(end)
+  {  }
+
+
+  // Whether no column in the span is dirty.
+  inline bool RowSpan::Empty() const
+  {
+    return Begin >= End;
+  }
+
+
     ///////////////////////////
    // Console Raster object //
   ///////////////////////////
   // Default constructor for the CanvasRaster- Zeros data and gets width and height.
+  // The initial fill isn't zero, so every row starts out dirty.
   inline CanvasRaster::CanvasRaster(unsigned int width, unsigned int height)
     : width_(width)
     , height_(height)
     , data_(width, height, RasterInfo(' ', RConsole::WHITE))
-  {  }
+    , spans_(height)
+    , dirtyRowBegin_(0)
+    , dirtyRowEnd_(0)
+    , generation_(ZeroGeneration)
+  {
+    markAllDirty();
+  }
+
+
+  // Exchanges contents and dirty spans with another raster. Only pointers move.
+  inline void CanvasRaster::Swap(CanvasRaster &rhs)
+  {
+    std::swap(width_, rhs.width_);
+    std::swap(height_, rhs.height_);
+    data_.Swap(rhs.data_);
+    spans_.swap(rhs.spans_);
+    std::swap(dirtyRowBegin_, rhs.dirtyRowBegin_);
+    std::swap(dirtyRowEnd_, rhs.dirtyRowEnd_);
+    std::swap(generation_, rhs.generation_);
+  }
+
+
+  // Changes size, keeping what's drawn where the old and new sizes overlap. Memory is only
+  // reallocated if the raster grows past what it has held. Spans are clipped to the new
+  // size, so everything outside them is still zero.
+  inline void CanvasRaster::Resize(unsigned int width, unsigned int height)
+  {
+    if (width == width_ && height == height_)
+      return;
+
+    data_.Resize(width, height);
+    spans_.resize(height);
+    for (RowSpan &span : spans_)
+    {
+      if (span.End > width)
+        span.End = width;
+      if (span.Empty())
+        span = RowSpan();
+    }
+
+    width_ = width;
+    height_ = height;
+    if (dirtyRowEnd_ > height_)
+      dirtyRowEnd_ = height_;
+    if (dirtyRowBegin_ > height_)
+      dirtyRowBegin_ = height_;
+
+    // Grown space is zero, so a cropped base is no longer any base at all.
+    if (generation_ != ZeroGeneration)
+      generation_ = UnknownGeneration;
+  }
 
 
   // Draws a character to the screen. Returns if it was successful or not.
@@ -1116,8 +1749,11 @@ namespace RConsole
 
     #endif // RConsole_CLIP_CONSOLE
 
+    RasterInfo ri(toDraw, color);
+    ri.SetModified(true);
     data_.GoTo(static_cast<int>(x), static_cast<int>(y));
-    data_.Set(RasterInfo(toDraw, color));
+    data_.Set(ri);
+    markDirty(data_.GetIndex(), 1);
   
     //Everything completed correctly.
     return true;
@@ -1128,10 +1764,14 @@ namespace RConsole
   inline bool CanvasRaster::WriteString(const char *toWrite, size_t len, float x, float y, Color color)
   {
 	  //Establish and check for a string of a usable size.
+	  RasterInfo ri(0, color);
+	  ri.SetModified(true);
 	  data_.GoTo(static_cast<int>(x), static_cast<int>(y));
+	  markDirty(data_.GetIndex(), len);
 	  for (unsigned int i = 0; i < len; ++i)
 	  {
-		  data_.Set(RasterInfo(toWrite[i], color));
+		  ri.SetValue(toWrite[i]);
+		  data_.Set(ri);
 		  data_.IncrementX();
 	  }
 
@@ -1140,39 +1780,262 @@ namespace RConsole
   }
 
 
-  // Writes a mass of spaces to the screen.
-  inline void CanvasRaster::Fill(const RasterInfo &ri)
-  {
-    data_.Fill(ri);
-  }
-  
-
-  // Clears out all of the data written to the raster. Does NOT move cursor to 0,0.
-  inline void CanvasRaster::Zero()
+  // Copies a sprite in with its top left corner at x, y. The sprite is clipped to the raster
+  // once, then each run is a single copy; whatever is under its transparent cells stays.
+  inline void CanvasRaster::WriteSprite(const Sprite &sprite, int x, int y)
   {
-    data_.Zero();
-  }
+    const int width = static_cast<int>(width_);
+    const int height = static_cast<int>(height_);
+    const int spriteWidth = static_cast<int>(sprite.width_);
+    if (x >= width || y >= height || x + spriteWidth <= 0 || y + static_cast<int>(sprite.height_) <= 0)
+      return;
 
+    // Visible columns of the sprite.
+    const int clipBegin = x < 0 ? -x : 0;
+    const int clipEnd = x + spriteWidth > width ? width - x : spriteWidth;
 
-  // Get a constant reference to the existing raster.
-  inline const Field2D<RasterInfo>& CanvasRaster::GetRasterData() const
-  {
-    return data_;
+    RasterInfo *head = data_.GetHead();
+    const RasterInfo *cells = sprite.cells_.data();
+    for (const Sprite::Run &run : sprite.runs_)
+    {
+      const int row = y + static_cast<int>(run.Row);
+      if (row < 0 || row >= height)
+        continue;
+
+      const int begin = std::max(static_cast<int>(run.Begin), clipBegin);
+      const int end = std::min(static_cast<int>(run.Begin + run.Length), clipEnd);
+      if (begin >= end)
+        continue;
+
+      const unsigned int index = static_cast<unsigned int>(row * width + x + begin);
+      memcpy(head + index, cells + run.Row * sprite.width_ + begin, (end - begin) * sizeof(RasterInfo));
+      markDirty(index, end - begin);
+    }
   }
 
 
-  // Underlying raster exposing.
-  inline Field2D<RasterInfo>& CanvasRaster::GetRasterData()
+  // Writes a batch of single glyphs, each at its own x, y and in its own color, the same as
+  // calling Canvas::Draw on each in order. Points are clipped a chunk at a time in a loop
+  // with no branches, which the compiler can vectorize, then the ones left are written
+  // straight to their cells with the row spans kept up as it goes.
+  inline void CanvasRaster::WritePoints(const float *x, const float *y, const char *glyphs, const Color *colors, size_t count)
   {
-    return data_;
-  }
-  
-
-  // Gets console width.
-  inline unsigned int CanvasRaster::GetRasterWidth() const
-  { 
-    return width_;
-  }  
+    const float width = static_cast<float>(width_);
+    const float height = static_cast<float>(height_);
+    RasterInfo *head = data_.GetHead();
+    int cols[PointChunk];
+    int rows[PointChunk];
+
+    for (size_t chunk = 0; chunk < count; chunk += PointChunk)
+    {
+      const size_t length = count - chunk < PointChunk ? count - chunk : PointChunk;
+      const float *chunkX = x + chunk;
+      const float *chunkY = y + chunk;
+
+      // Same bounds as Canvas::Draw. Clipped points get a column of -1.
+      for (size_t i = 0; i < length; ++i)
+      {
+        const float px = chunkX[i];
+        const float py = chunkY[i];
+        const bool isInside = (px > 0) & (px < width) & (py > 0) & (py < height);
+        cols[i] = isInside ? static_cast<int>(px) : -1;
+        rows[i] = static_cast<int>(isInside ? py : 0.0f);
+      }
+
+      for (size_t i = 0; i < length; ++i)
+      {
+        if (cols[i] < 0)
+          continue;
+
+        const unsigned int col = static_cast<unsigned int>(cols[i]);
+        const unsigned int row = static_cast<unsigned int>(rows[i]);
+        RasterInfo ri(glyphs[chunk + i], colors[chunk + i]);
+        ri.SetModified(true);
+        head[row * width_ + col] = ri;
+
+        RowSpan &span = spans_[row];
+        if (span.Empty())
+        {
+          span = RowSpan(col, col + 1);
+        }
+        else
+        {
+          if (col < span.Begin)
+            span.Begin = col;
+          if (col >= span.End)
+            span.End = col + 1;
+        }
+
+        if (row < dirtyRowBegin_)
+          dirtyRowBegin_ = row;
+        if (row >= dirtyRowEnd_)
+          dirtyRowEnd_ = row + 1;
+      }
+    }
+  }
+
+
+  // Writes a mass of spaces to the screen.
+  inline void CanvasRaster::Fill(const RasterInfo &ri)
+  {
+    data_.Fill(ri);
+    markAllDirty();
+  }
+  
+
+  // Clears out all of the data written to the raster. Does NOT move cursor to 0,0.
+  // Only the dirty spans are touched when everything else is already zero.
+  inline void CanvasRaster::Zero()
+  {
+    // Last cleared to a base, so the zeros have to go everywhere.
+    const bool isWhole = generation_ != ZeroGeneration;
+    if (isWhole)
+    {
+      data_.Zero();
+      generation_ = ZeroGeneration;
+    }
+
+    for (unsigned int row = dirtyRowBegin_; row < dirtyRowEnd_; ++row)
+    {
+      RowSpan &span = spans_[row];
+      if (!isWhole && !span.Empty())
+        data_.Zero(row * width_ + span.Begin, span.End - span.Begin);
+      span = RowSpan();
+    }
+
+    dirtyRowBegin_ = height_;
+    dirtyRowEnd_ = 0;
+  }
+
+
+  // Clears the raster back to a base instead of to zero, like a canvas's static layers.
+  // Only the dirty spans are copied if the raster was last cleared to this same generation
+  // of the base; otherwise all of it is. The base has to be the raster's size.
+  inline void CanvasRaster::Restore(const Field2D<RasterInfo> &base, unsigned int generation)
+  {
+    const RasterInfo *from = base.GetHead();
+    RasterInfo *head = data_.GetHead();
+    if (generation_ != generation)
+    {
+      memcpy(head, from, width_ * height_ * sizeof(RasterInfo));
+      generation_ = generation;
+    }
+    else
+    {
+      for (unsigned int row = dirtyRowBegin_; row < dirtyRowEnd_; ++row)
+      {
+        const RowSpan &span = spans_[row];
+        if (!span.Empty())
+        {
+          const unsigned int offset = row * width_ + span.Begin;
+          memcpy(head + offset, from + offset, (span.End - span.Begin) * sizeof(RasterInfo));
+        }
+      }
+    }
+
+    for (unsigned int row = dirtyRowBegin_; row < dirtyRowEnd_; ++row)
+      spans_[row] = RowSpan();
+
+    dirtyRowBegin_ = height_;
+    dirtyRowEnd_ = 0;
+  }
+
+
+  // Which base is outside the dirty spans: ZeroGeneration for zero, UnknownGeneration if
+  // resizing left it neither, and otherwise whatever generation was last passed to Restore.
+  inline unsigned int CanvasRaster::GetGeneration() const
+  {
+    return generation_;
+  }
+
+
+  // Get the written columns of a row.
+  inline const RowSpan &CanvasRaster::GetRowSpan(unsigned int row) const
+  {
+    return spans_[row];
+  }
+
+
+  // First row that may have been written to.
+  inline unsigned int CanvasRaster::GetDirtyRowBegin() const
+  {
+    return dirtyRowBegin_;
+  }
+
+
+  // One past the last row that may have been written to.
+  inline unsigned int CanvasRaster::GetDirtyRowEnd() const
+  {
+    return dirtyRowEnd_;
+  }
+
+
+  // Grows the row spans to cover len cells starting at the linear index, wrapping
+  // onto following rows like the write itself does. Cells past the end are ignored.
+  inline void CanvasRaster::markDirty(unsigned int index, size_t len)
+  {
+    const unsigned int length = width_ * height_;
+    if (index >= length || len == 0)
+      return;
+
+    unsigned int last = (len > length - index) ? length - 1 : index + static_cast<unsigned int>(len) - 1;
+    unsigned int row = index / width_;
+    const unsigned int lastRow = last / width_;
+
+    if (row < dirtyRowBegin_)
+      dirtyRowBegin_ = row;
+    if (lastRow + 1 > dirtyRowEnd_)
+      dirtyRowEnd_ = lastRow + 1;
+
+    for (; row <= lastRow; ++row)
+    {
+      const unsigned int begin = (row == index / width_) ? index % width_ : 0;
+      const unsigned int end = (row == lastRow) ? last % width_ + 1 : width_;
+      RowSpan &span = spans_[row];
+      if (span.Empty())
+      {
+        span = RowSpan(begin, end);
+        continue;
+      }
+
+      if (begin < span.Begin)
+        span.Begin = begin;
+      if (end > span.End)
+        span.End = end;
+    }
+  }
+
+
+  // Marks every cell as written.
+  inline void CanvasRaster::markAllDirty()
+  {
+    for (unsigned int row = 0; row < height_; ++row)
+      spans_[row] = RowSpan(0, width_);
+
+    dirtyRowBegin_ = 0;
+    dirtyRowEnd_ = height_;
+  }
+
+
+  // Get a constant reference to the existing raster.
+  inline const Field2D<RasterInfo>& CanvasRaster::GetRasterData() const
+  {
+    return data_;
+  }
+
+
+  // Underlying raster exposing.
+  inline Field2D<RasterInfo>& CanvasRaster::GetRasterData()
+  {
+    return data_;
+  }
+  
+
+  // Gets console width.
+  inline unsigned int CanvasRaster::GetRasterWidth() const
+  { 
+    return width_;
+  }  
 
 
   // Get console height
@@ -1183,378 +2046,1915 @@ namespace RConsole
 }
 
 ///////////////////////////////////////////////////////////////////////
-//Canvas.cpp
+//Sprite.cpp
 ///////////////////////////////////////////////////////////////////////
-#include <cstdio>           // PutC
-#include <iostream>         // ostream access
-#include <csignal>          // Signal termination.
-#include <chrono>           // Time related info for sleeping.
-#include <thread>           // Sleep on exit to allow for update to finish.
-#include <string>           // String for parsing.
+#include <fstream>          // LoadFile.
+#include <sstream>          // Reading sprite text line by line.
+#include <cstdlib>          // strtol for legend bytes.
+
+
+namespace RConsole
+{
+  // Starts out empty; draws nothing until loaded.
+  inline Sprite::Sprite()
+    : width_(0)
+    , height_(0)
+    , cells_()
+    , runs_()
+  {  }
+
+
+  // Compiles sprite text (see the class comment). Returns false, leaving the sprite as it
+  // was, if a section is missing, a legend line is malformed, or a visible glyph has no color.
+  inline bool Sprite::Load(const std::string &text)
+  {
+    enum Section { NONE, LEGEND, GLYPHS, COLORS } section = NONE;
+    unsigned char legend[256];
+    for (int i = 0; i < 256; ++i)
+      legend[i] = static_cast<unsigned char>(i);
+
+    std::vector<std::string> glyphs;
+    std::vector<std::string> colors;
+    bool hasGlyphs = false;
+    bool hasColors = false;
+
+    std::istringstream lines(text);
+    std::string line;
+    while (std::getline(lines, line))
+    {
+      if (!line.empty() && line[line.size() - 1] == '\r')
+        line.erase(line.size() - 1);
+
+      if (line == "[legend]") { section = LEGEND; continue; }
+      if (line == "[glyphs]") { section = GLYPHS; hasGlyphs = true; continue; }
+      if (line == "[colors]") { section = COLORS; hasColors = true; continue; }
+
+      if (section == LEGEND)
+      {
+        if (line.empty())
+          continue;
+
+        const char *digits = line.c_str() + 2;
+        char *end = nullptr;
+        const long value = line.size() >= 3 && line[1] == ' ' ? strtol(digits, &end, 10) : -1;
+        if (value < 0 || value > 255 || end == digits)
+          return false;
+        legend[static_cast<unsigned char>(line[0])] = static_cast<unsigned char>(value);
+      }
+      else if (section == GLYPHS)
+        glyphs.push_back(line);
+      else if (section == COLORS)
+        colors.push_back(line);
+    }
+
+    if (!hasGlyphs || !hasColors)
+      return false;
+
+    // Trailing blank lines are just the end of the text, not transparent rows.
+    while (!glyphs.empty() && glyphs.back().empty())
+      glyphs.pop_back();
+
+    unsigned int width = 0;
+    for (const std::string &row : glyphs)
+      width = std::max(width, static_cast<unsigned int>(row.size()));
+    const unsigned int height = static_cast<unsigned int>(glyphs.size());
+
+    std::vector<RasterInfo> cells(width * height);
+    std::vector<Run> runs;
+    for (unsigned int row = 0; row < height; ++row)
+    {
+      const std::string &glyphRow = glyphs[row];
+      const std::string colorRow = row < colors.size() ? colors[row] : std::string();
+      for (unsigned int col = 0; col < glyphRow.size(); ++col)
+      {
+        if (glyphRow[col] == ' ')
+          continue;
+
+        const char digit = col < colorRow.size() ? colorRow[col] : ' ';
+        int color = -1;
+        if (digit >= '0' && digit <= '9')
+          color = digit - '0';
+        else if (digit >= 'a' && digit <= 'f')
+          color = digit - 'a' + 10;
+        else if (digit >= 'A' && digit <= 'F')
+          color = digit - 'A' + 10;
+        if (color < 0)
+          return false;
+
+        RasterInfo ri(static_cast<char>(legend[static_cast<unsigned char>(glyphRow[col])]), static_cast<Color>(color));
+        ri.SetModified(true);
+        cells[row * width + col] = ri;
+
+        // Extend the run this cell continues, or start a new one.
+        if (!runs.empty() && runs.back().Row == row && runs.back().Begin + runs.back().Length == col)
+          ++runs.back().Length;
+        else
+          runs.push_back(Run{ row, col, 1 });
+      }
+    }
+
+    width_ = width;
+    height_ = height;
+    cells_.swap(cells);
+    runs_.swap(runs);
+    return true;
+  }
+
+
+  // Loads sprite text from a file. Returns false if it can't be read or doesn't compile.
+  inline bool Sprite::LoadFile(const std::string &path)
+  {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+      return false;
+
+    std::ostringstream text;
+    text << file.rdbuf();
+    return Load(text.str());
+  }
+
+
+  // Width of the widest row.
+  inline unsigned int Sprite::GetWidth() const
+  {
+    return width_;
+  }
+
+
+  // Number of rows.
+  inline unsigned int Sprite::GetHeight() const
+  {
+    return height_;
+  }
+
 
+  // Number of copies it takes to draw, if none of it is clipped.
+  inline size_t Sprite::GetRunCount() const
+  {
+    return runs_.size();
+  }
+}
 
+///////////////////////////////////////////////////////////////////////
+//FrameBuffer.cpp
+///////////////////////////////////////////////////////////////////////
+#include <cerrno>           // Interrupted write detection.
+#include <climits>          // UINT_MAX for unknown cursor positions.
 
 
 namespace RConsole
 {
-  #define DEFAULT_WIDTH_SIZE (rlutil::tcols() - 1)
-  #define DEFAULT_HEIGHT_SIZE rlutil::trows()
+  // Starts empty; storage is allocated on first use or Reserve.
+  inline FrameBuffer::FrameBuffer()
+    : bytes_()
+    , size_(0)
+  {  }
 
-  //// Static initialization in non-guaranteed order.
-  //CanvasRaster Canvas::r_         = CanvasRaster(DEFAULT_WIDTH_SIZE, DEFAULT_HEIGHT_SIZE);
-  //CanvasRaster Canvas::prev_      = CanvasRaster(DEFAULT_WIDTH_SIZE, DEFAULT_HEIGHT_SIZE);
-  //bool Canvas::hasLazyInit_       = false;
-  //bool Canvas::isDrawing_         = true;
-  //unsigned int Canvas::width_     = DEFAULT_WIDTH_SIZE;
-  //unsigned int Canvas::height_    = DEFAULT_HEIGHT_SIZE;
-  //Field2D<bool> Canvas::modified_ = Field2D<bool>(DEFAULT_WIDTH_SIZE, DEFAULT_HEIGHT_SIZE);
+
+  // Makes sure at least the specified number of bytes fit without growing.
+  inline void FrameBuffer::Reserve(size_t bytes)
+  {
+    if (bytes > bytes_.size())
+      grow(bytes);
+  }
 
 
-    /////////////////////////////
-   // Public Member Functions //
-  /////////////////////////////
-  // Setup with width and height. Can be re-init
-  inline void Canvas::ReInit(unsigned int width, unsigned int height)
+  // Empties the buffer, keeping the storage around for the next frame.
+  inline void FrameBuffer::Clear()
+  {
+    size_ = 0;
+  }
+
+
+  // Appends a single byte.
+  inline void FrameBuffer::Append(char c)
+  {
+    if (size_ + 1 > bytes_.size())
+      grow(size_ + 1);
+
+    bytes_[size_++] = c;
+  }
+
+
+  // Appends a run of bytes.
+  inline void FrameBuffer::Append(const char *bytes, size_t len)
   {
+    if (size_ + len > bytes_.size())
+      grow(size_ + len);
+
+    memcpy(bytes_.data() + size_, bytes, len);
+    size_ += len;
+  }
+
+
+  // Appends the decimal representation of a number, no stream or string involved.
+  inline void FrameBuffer::AppendNumber(unsigned int value)
+  {
+    char digits[10];
+    int count = 0;
+    do
+    {
+      digits[count++] = static_cast<char>('0' + value % 10);
+      value /= 10;
+    } while (value != 0);
+
+    while (count > 0)
+      Append(digits[--count]);
+  }
+
+
+  // Appends an ANSI cursor move to the 1-based x, y. Same sequence as rlutil::locate.
+  inline void FrameBuffer::AppendLocate(unsigned int x, unsigned int y)
+  {
+    Append("\033[", 2);
+    AppendNumber(y);
+    Append(';');
+    AppendNumber(x);
+    Append('H');
+  }
+
+
+  // Appends an ANSI relative move of the cursor to the right.
+  inline void FrameBuffer::AppendCursorForward(unsigned int count)
+  {
+    Append("\033[", 2);
+    AppendNumber(count);
+    Append('C');
+  }
+
+
+  // Appends the ANSI sequence for a color. PREVIOUS_COLOR appends nothing.
+  inline void FrameBuffer::AppendColor(Color color)
+  {
+    if (color == PREVIOUS_COLOR)
+      return;
+
+    const std::string ansi = rlutil::getANSIColor(color);
+    Append(ansi.c_str(), ansi.size());
+  }
+
+
+  // Writes everything out to stdout in one call and empties the buffer.
+  // Returns false if the terminal would not take all of it.
+  inline bool FrameBuffer::Flush()
+  {
+    // Anything already queued through the streams has to land first.
     std::cout << std::flush;
-    if (width == 0) 
-      width = 1;
-    if (height == 0)
-      height = 1;
+    fflush(stdout);
 
-    width_ = width;
-    height_ = height;
-    r_ = CanvasRaster(width, height);
-    prev_ = CanvasRaster(width, height);
-    modified_ = Field2D<bool>(width, height);
+    bool success = true;
+    #ifdef OS_WINDOWS
+    success = fwrite(bytes_.data(), 1, size_, stdout) == size_;
+    fflush(stdout);
+    #else
+    size_t written = 0;
+    while (written < size_)
+    {
+      ssize_t result = ::write(STDOUT_FILENO, bytes_.data() + written, size_ - written);
+      if (result < 0)
+      {
+        if (errno == EINTR)
+          continue;
+
+        success = false;
+        break;
+      }
+      written += static_cast<size_t>(result);
+    }
+    #endif
+
+    Clear();
+    return success;
+  }
+
+
+  // Writes everything assembled to a file instead of the terminal, then empties the buffer.
+  // Left to stdio's buffering; nothing is watching a file frame by frame.
+  inline bool FrameBuffer::FlushTo(FILE *file)
+  {
+    const bool success = fwrite(bytes_.data(), 1, size_, file) == size_;
+    Clear();
+    return success;
+  }
+
+
+  // Moves everything assembled onto the end of sink, then empties the buffer.
+  inline void FrameBuffer::FlushTo(std::vector<char> &sink)
+  {
+    sink.insert(sink.end(), bytes_.data(), bytes_.data() + size_);
+    Clear();
+  }
+
+
+  // Raw access to the bytes assembled so far.
+  inline const char *FrameBuffer::Data() const
+  {
+    return bytes_.data();
+  }
+
+
+  // Number of bytes assembled so far.
+  inline size_t FrameBuffer::Size() const
+  {
+    return size_;
+  }
+
+
+  // Grows storage geometrically so appends stay amortized constant.
+  inline void FrameBuffer::grow(size_t minCapacity)
+  {
+    size_t capacity = bytes_.size() * 2;
+    if (capacity < minCapacity)
+      capacity = minCapacity;
+    if (capacity < 4096)
+      capacity = 4096;
+
+    bytes_.resize(capacity);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////
+//RasterDiff.cpp
+///////////////////////////////////////////////////////////////////////
+#ifdef CPU_FEATURES_X86
+#include <emmintrin.h>      // SSE2
+#include <immintrin.h>      // AVX2
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>         // _BitScanForward
+#endif
+
+// Lets a single function opt in to an instruction set without building the whole
+// file with it. MSVC allows the intrinsics anywhere, so it needs nothing.
+#if defined(__GNUC__) || defined(__clang__)
+#define RASTER_DIFF_TARGET(isa) __attribute__((target(isa)))
+#else
+#define RASTER_DIFF_TARGET(isa)
+#endif
+
+
+namespace RConsole
+{
+  namespace RasterDiff
+  {
+    // The vector kernels work on cells as raw 16-bit words.
+    const bool IsVectorLayout = sizeof(RasterInfo) == sizeof(unsigned short);
+
+
+    // Index of the lowest set bit of a non-zero mask.
+    inline unsigned int lowestBit(unsigned int mask)
+    {
+#if defined(_MSC_VER)
+      unsigned long bit;
+      _BitScanForward(&bit, mask);
+      return static_cast<unsigned int>(bit);
+#elif defined(__GNUC__) || defined(__clang__)
+      return static_cast<unsigned int>(__builtin_ctz(mask));
+#else
+      unsigned int bit = 0;
+      while (!(mask & 1u))
+      {
+        mask >>= 1;
+        ++bit;
+      }
+      return bit;
+#endif
+    }
+
+
+    // Whether a cell needs to be written out: it differs from last frame, and either
+    // has a glyph or wasn't drawn to this frame (so whatever was there gets blanked).
+    inline bool needsEmit(const RasterInfo &curr, const RasterInfo &prev)
+    {
+      return curr != prev && (curr.GetValue() != 0 || !curr.IsModified());
+    }
+
+
+    // Adds a cell to the runs, extending the last one if it ends right where this starts.
+    inline void pushCell(CellRun *runs, size_t &count, unsigned int index)
+    {
+      if (count > 0 && runs[count - 1].End == index)
+      {
+        ++runs[count - 1].End;
+        return;
+      }
+
+      runs[count].Begin = index;
+      runs[count].End = index + 1;
+      ++count;
+    }
+
+
+    // Records every cell in a bitmask, relative to begin.
+    inline void pushCells(unsigned int begin, unsigned int cellMask, CellRun *runs, size_t &count)
+    {
+      while (cellMask != 0)
+      {
+        pushCell(runs, count, begin + lowestBit(cellMask));
+        cellMask &= cellMask - 1;
+      }
+    }
+
+
+    // One cell at a time.
+    inline size_t FindChangesScalar(const RasterInfo *curr, const RasterInfo *prev,
+                                    unsigned int begin, unsigned int end, CellRun *runs)
+    {
+      size_t count = 0;
+      for (unsigned int index = begin; index < end; ++index)
+      {
+        if (needsEmit(curr[index], prev[index]))
+          pushCell(runs, count, index);
+      }
+
+      return count;
+    }
+
+#ifdef CPU_FEATURES_X86
+    // needsEmit for eight cells, as a 16-bit lane mask.
+    RASTER_DIFF_TARGET("sse2")
+    inline __m128i needsEmitSSE2(__m128i curr, __m128i prev)
+    {
+      const __m128i compareMask = _mm_set1_epi16(static_cast<short>(RasterInfo::CompareMask));
+      const __m128i glyphMask = _mm_set1_epi16(static_cast<short>(RasterInfo::GlyphMask));
+      const __m128i modifiedFlag = _mm_set1_epi16(static_cast<short>(RasterInfo::ModifiedFlag));
+      const __m128i zero = _mm_setzero_si128();
+
+      const __m128i same = _mm_cmpeq_epi16(_mm_and_si128(_mm_xor_si128(curr, prev), compareMask), zero);
+      const __m128i noGlyph = _mm_cmpeq_epi16(_mm_and_si128(curr, glyphMask), zero);
+      const __m128i drawn = _mm_cmpeq_epi16(_mm_and_si128(curr, modifiedFlag), modifiedFlag);
+
+      // Skip if unchanged, or if drawn this frame with nothing to show.
+      return _mm_andnot_si128(_mm_or_si128(same, _mm_and_si128(noGlyph, drawn)), _mm_set1_epi16(-1));
+    }
+
+
+    // Sixteen cells per step, eight per register.
+    RASTER_DIFF_TARGET("sse2")
+    inline size_t FindChangesSSE2(const RasterInfo *curr, const RasterInfo *prev,
+                                  unsigned int begin, unsigned int end, CellRun *runs)
+    {
+      size_t count = 0;
+      unsigned int index = begin;
+
+      for (; index + 16 <= end; index += 16)
+      {
+        const __m128i *a = reinterpret_cast<const __m128i *>(curr + index);
+        const __m128i *b = reinterpret_cast<const __m128i *>(prev + index);
+        const __m128i low = needsEmitSSE2(_mm_loadu_si128(a), _mm_loadu_si128(b));
+        const __m128i high = needsEmitSSE2(_mm_loadu_si128(a + 1), _mm_loadu_si128(b + 1));
+
+        // Narrow each 16-bit lane to a byte so the movemask is one bit per cell.
+        const unsigned int cellMask = static_cast<unsigned int>(_mm_movemask_epi8(_mm_packs_epi16(low, high)));
+        if (cellMask != 0)
+          pushCells(index, cellMask, runs, count);
+      }
+
+      for (; index < end; ++index)
+      {
+        if (needsEmit(curr[index], prev[index]))
+          pushCell(runs, count, index);
+      }
+
+      return count;
+    }
+
+
+    // needsEmit for sixteen cells, as a 16-bit lane mask.
+    RASTER_DIFF_TARGET("avx2")
+    inline __m256i needsEmitAVX2(__m256i curr, __m256i prev)
+    {
+      const __m256i compareMask = _mm256_set1_epi16(static_cast<short>(RasterInfo::CompareMask));
+      const __m256i glyphMask = _mm256_set1_epi16(static_cast<short>(RasterInfo::GlyphMask));
+      const __m256i modifiedFlag = _mm256_set1_epi16(static_cast<short>(RasterInfo::ModifiedFlag));
+      const __m256i zero = _mm256_setzero_si256();
+
+      const __m256i same = _mm256_cmpeq_epi16(_mm256_and_si256(_mm256_xor_si256(curr, prev), compareMask), zero);
+      const __m256i noGlyph = _mm256_cmpeq_epi16(_mm256_and_si256(curr, glyphMask), zero);
+      const __m256i drawn = _mm256_cmpeq_epi16(_mm256_and_si256(curr, modifiedFlag), modifiedFlag);
+
+      // Skip if unchanged, or if drawn this frame with nothing to show.
+      return _mm256_andnot_si256(_mm256_or_si256(same, _mm256_and_si256(noGlyph, drawn)), _mm256_set1_epi16(-1));
+    }
+
+
+    // Thirty-two cells per step, sixteen per register.
+    RASTER_DIFF_TARGET("avx2")
+    inline size_t FindChangesAVX2(const RasterInfo *curr, const RasterInfo *prev,
+                                  unsigned int begin, unsigned int end, CellRun *runs)
+    {
+      size_t count = 0;
+      unsigned int index = begin;
+
+      for (; index + 32 <= end; index += 32)
+      {
+        const __m256i *a = reinterpret_cast<const __m256i *>(curr + index);
+        const __m256i *b = reinterpret_cast<const __m256i *>(prev + index);
+        const __m256i low = needsEmitAVX2(_mm256_loadu_si256(a), _mm256_loadu_si256(b));
+        const __m256i high = needsEmitAVX2(_mm256_loadu_si256(a + 1), _mm256_loadu_si256(b + 1));
+
+        // Packing works within 128-bit halves, so put the quarters back in cell order after.
+        const __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(low, high), _MM_SHUFFLE(3, 1, 2, 0));
+        const unsigned int cellMask = static_cast<unsigned int>(_mm256_movemask_epi8(packed));
+        if (cellMask != 0)
+          pushCells(index, cellMask, runs, count);
+      }
+
+      // A half step before the scalar tail, since rows are rarely a multiple of 32 wide.
+      if (index + 16 <= end)
+      {
+        const __m128i *a = reinterpret_cast<const __m128i *>(curr + index);
+        const __m128i *b = reinterpret_cast<const __m128i *>(prev + index);
+        const __m128i low = needsEmitSSE2(_mm_loadu_si128(a), _mm_loadu_si128(b));
+        const __m128i high = needsEmitSSE2(_mm_loadu_si128(a + 1), _mm_loadu_si128(b + 1));
+        const unsigned int cellMask = static_cast<unsigned int>(_mm_movemask_epi8(_mm_packs_epi16(low, high)));
+        if (cellMask != 0)
+          pushCells(index, cellMask, runs, count);
+        index += 16;
+      }
+
+      for (; index < end; ++index)
+      {
+        if (needsEmit(curr[index], prev[index]))
+          pushCell(runs, count, index);
+      }
+
+      return count;
+    }
+#endif // CPU_FEATURES_X86
+
+
+    // Kernel for a specific SIMD level. Falls back to scalar if the level isn't compiled in
+    // or the cell layout isn't one the vector kernels understand.
+    inline FindChangesFunc GetFindChanges(CpuFeatures::SimdLevel level)
+    {
+#ifdef CPU_FEATURES_X86
+      if (IsVectorLayout)
+      {
+        switch (level)
+        {
+          case CpuFeatures::SIMD_AVX2: return FindChangesAVX2;
+          case CpuFeatures::SIMD_SSE2: return FindChangesSSE2;
+          default: break;
+        }
+      }
+#endif
+      (void)level;
+      return FindChangesScalar;
+    }
+
+
+    // Widest kernel the running CPU supports, chosen once.
+    inline FindChangesFunc GetFindChanges()
+    {
+      static const FindChangesFunc findChanges = GetFindChanges(CpuFeatures::GetSimdLevel());
+      return findChanges;
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////////////////
+//RasterTripleBuffer.cpp
+///////////////////////////////////////////////////////////////////////
+#ifndef RConsole_NO_THREADING
+
+
+namespace RConsole
+{
+  // Three empty rasters. Slot 0 starts with the producer, 1 with the consumer, 2 in the middle.
+  inline RasterTripleBuffer::RasterTripleBuffer(unsigned int width, unsigned int height)
+    : slots_()
+    , back_(0)
+    , front_(1)
+    , middle_(2)
+    , dropped_(0)
+  {
+    Reset(width, height);
+  }
+
+
+  // Sizes every slot, empty, and drops any frame in flight. Slots are resized in place,
+  // so this only allocates when they grow. Neither side can be using the buffer while
+  // this runs.
+  inline void RasterTripleBuffer::Reset(unsigned int width, unsigned int height)
+  {
+    if (slots_.size() != 3)
+      slots_.assign(3, CanvasRaster(width, height));
+
+    for (CanvasRaster &slot : slots_)
+    {
+      slot.Resize(width, height);
+      slot.Zero();
+    }
+
+    back_ = 0;
+    front_ = 1;
+    middle_ = 2;
+  }
+
+
+  // Producer side. Trades the finished raster for another: the frame goes to the middle
+  // slot, and whatever was there comes back for the producer to clear for drawing.
+  inline void RasterTripleBuffer::Publish(CanvasRaster &drawn)
+  {
+    drawn.Swap(slots_[back_]);
+    const unsigned int previous = middle_.exchange(back_ | FreshFlag, std::memory_order_acq_rel);
+    if (previous & FreshFlag)
+      ++dropped_;
+
+    back_ = previous & IndexMask;
+  }
+
+
+  // Consumer side. Takes the latest finished frame if there is one the consumer hasn't
+  // seen, handing its old slot back to the middle. Returns if Front changed.
+  inline bool RasterTripleBuffer::Acquire()
+  {
+    if ((middle_.load(std::memory_order_acquire) & FreshFlag) == 0)
+      return false;
+
+    front_ = middle_.exchange(front_, std::memory_order_acq_rel) & IndexMask;
+    return true;
+  }
+
+
+  // If a finished frame is waiting that the consumer hasn't taken yet.
+  inline bool RasterTripleBuffer::HasFresh() const
+  {
+    return (middle_.load(std::memory_order_acquire) & FreshFlag) != 0;
+  }
+
+
+  // The consumer's raster.
+  inline CanvasRaster &RasterTripleBuffer::Front()
+  {
+    return slots_[front_];
+  }
+
+
+  // Total frames published over the top of one the consumer never took. Producer side.
+  inline size_t RasterTripleBuffer::GetDropped() const
+  {
+    return dropped_;
+  }
+}
+#endif // RConsole_NO_THREADING
+
+///////////////////////////////////////////////////////////////////////
+//TerminalSize.cpp
+///////////////////////////////////////////////////////////////////////
+#include <csignal>          // SIGWINCH.
+#ifndef _WIN32
+#include <fcntl.h>          // Non-blocking self-pipe.
+#endif
+
+
+namespace RConsole
+{
+  // Re-reads the size if it may have changed, returning if it did. Cheap when nothing has:
+  // a flag check on POSIX, a clock read on Windows. Also drains the resize handle.
+  inline bool TerminalSize::Refresh()
+  {
+    if (!isWatching_)
+      watch();
+
+  #ifdef _WIN32
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (now - lastQuery_ >= std::chrono::milliseconds(RefreshMilliseconds))
+    {
+      isStale_ = true;
+      lastQuery_ = now;
+    }
+  #else
+    if (resizePipe_[0] >= 0)
+    {
+      char drain[16];
+      while (read(resizePipe_[0], drain, sizeof(drain)) > 0) { }
+    }
+  #endif
+
+    if (!isStale_.exchange(false))
+      return false;
+
+    const unsigned int columns = columns_;
+    const unsigned int rows = rows_;
+    query();
+    return columns != columns_ || rows != rows_;
+  }
+
+
+  // Terminal width in columns, as of the last refresh.
+  inline unsigned int TerminalSize::GetColumns()
+  {
+    if (isStale_ && columns_ == 0)
+      Refresh();
+
+    return columns_;
+  }
+
+
+  // Terminal height in rows, as of the last refresh.
+  inline unsigned int TerminalSize::GetRows()
+  {
+    if (isStale_ && rows_ == 0)
+      Refresh();
+
+    return rows_;
+  }
+
+
+  // A descriptor that turns readable when the terminal is resized, for waiting on with poll.
+  // Refresh drains it. -1 where there isn't one.
+  inline int TerminalSize::GetResizeHandle()
+  {
+    if (!isWatching_)
+      watch();
+
+    return resizePipe_[0];
+  }
+
+
+  // Sets up the self-pipe and SIGWINCH handler. Only ever done once.
+  inline void TerminalSize::watch()
+  {
+    isWatching_ = true;
+  #ifndef _WIN32
+    if (pipe(resizePipe_) != 0)
+    {
+      resizePipe_[0] = -1;
+      resizePipe_[1] = -1;
+      return;
+    }
+
+    for (int i = 0; i < 2; ++i)
+    {
+      fcntl(resizePipe_[i], F_SETFL, fcntl(resizePipe_[i], F_GETFL) | O_NONBLOCK);
+      fcntl(resizePipe_[i], F_SETFD, FD_CLOEXEC);
+    }
+
+    struct sigaction action;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    action.sa_handler = onResize;
+    sigaction(SIGWINCH, &action, nullptr);
+  #endif
+  }
+
+
+  // Asks the terminal for its size. One ioctl answers both where rlutil makes one each,
+  // and stdout is tried first so redirected input doesn't hide the size.
+  inline void TerminalSize::query()
+  {
+    int columns = -1;
+    int rows = -1;
+  #if !defined(_WIN32) && defined(TIOCGWINSZ)
+    struct winsize ws;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 || ioctl(STDIN_FILENO, TIOCGWINSZ, &ws) == 0)
+    {
+      columns = ws.ws_col;
+      rows = ws.ws_row;
+    }
+  #else
+    columns = rlutil::tcols();
+    rows = rlutil::trows();
+  #endif
+
+    columns_ = columns > 0 ? static_cast<unsigned int>(columns) : 1;
+    rows_ = rows > 0 ? static_cast<unsigned int>(rows) : 1;
+  }
+
+
+  // SIGWINCH handler. Only touches the flag and the pipe, both safe from a signal.
+  inline void TerminalSize::onResize(int)
+  {
+  #ifndef _WIN32
+    const int saved = errno;
+    isStale_ = true;
+    const char wake = 1;
+    if (write(resizePipe_[1], &wake, 1) < 0) { } // A full pipe already has a wakeup pending.
+    errno = saved;
+  #endif
+  }
+}
+
+///////////////////////////////////////////////////////////////////////
+//Canvas.cpp
+///////////////////////////////////////////////////////////////////////
+#include <cstdio>           // PutC
+#include <iostream>         // ostream access
+#include <csignal>          // Signal termination.
+#include <string>           // String for parsing.
+
+
+
+
+namespace RConsole
+{
+  #define DEFAULT_WIDTH_SIZE (TerminalSize::GetColumns() > 1 ? TerminalSize::GetColumns() - 1 : 1)
+  #define DEFAULT_HEIGHT_SIZE (TerminalSize::GetRows())
+
+  //// Static initialization in non-guaranteed order.
+  //CanvasRaster Canvas::r_         = CanvasRaster(DEFAULT_WIDTH_SIZE, DEFAULT_HEIGHT_SIZE);
+  //CanvasRaster Canvas::prev_      = CanvasRaster(DEFAULT_WIDTH_SIZE, DEFAULT_HEIGHT_SIZE);
+  //bool Canvas::hasLazyInit_       = false;
+  //bool Canvas::isDrawing_         = true;
+  //unsigned int Canvas::width_     = DEFAULT_WIDTH_SIZE;
+  //unsigned int Canvas::height_    = DEFAULT_HEIGHT_SIZE;
+
+
+    /////////////////////////////
+   // Public Member Functions //
+  /////////////////////////////
+  // Setup with width and height. Can be re-init
+  inline void Canvas::ReInit(unsigned int width, unsigned int height)
+  {
+    const bool wasRendering = pauseRenderThread();
+    std::cout << std::flush;
+    if (width == 0) 
+      width = 1;
+    if (height == 0)
+      height = 1;
+
+    width_ = width;
+    height_ = height;
+    r_ = CanvasRaster(width, height);
+    prev_ = CanvasRaster(width, height);
+    if (hasLayers_)
+    {
+      backLayer_ = CanvasRaster(width, height);
+      frontLayer_ = CanvasRaster(width, height);
+      backLayer_.Zero();
+      frontLayer_.Zero();
+      base_.Resize(width, height);
+      layersChanged_ = true;
+    }
+
+    // Rough guess at a busy frame, so the buffer rarely has to grow mid-frame.
+    frame_.Reserve(width * height * 4);
+    forgetTerminalState();
+    resumeRenderThread(wasRendering);
+  }
+
+
+  // Changes the canvas size without starting over. What's drawn is kept where the old and
+  // new sizes overlap, and memory is only reallocated if the canvas grows past anything it
+  // has held. Terminals rewrap or scroll on resize in their own ways, so what's on screen
+  // can't be trusted afterward: the next frame clears it, in the same write as the frame
+  // itself when buffered, and draws only the cells that aren't blank.
+  inline void Canvas::Resize(unsigned int width, unsigned int height)
+  {
+    if (width == 0)
+      width = 1;
+    if (height == 0)
+      height = 1;
+    if (width == width_ && height == height_)
+      return;
+
+    const bool wasRendering = pauseRenderThread();
+    width_ = width;
+    height_ = height;
+    r_.Resize(width, height);
+    prev_.Resize(width, height);
+    prev_.Zero();
+    clearPending_ = true;
+    if (hasLayers_)
+    {
+      backLayer_.Resize(width, height);
+      frontLayer_.Resize(width, height);
+      base_.Resize(width, height);
+      layersChanged_ = true;
+    }
+
+    frame_.Reserve(width * height * 4);
+    forgetTerminalState();
+    resumeRenderThread(wasRendering);
+  }
+
+
+  // Clear out the screen that the user sees.
+  // Note: More expensive than clearing just the previous spaces
+  // but less expensive than clearing entire buffer with command.
+  inline void Canvas::FillCanvas(const RasterInfo &ri)
+  {
+    target_->Fill(ri);
+  }
+
+  // Write the specific character in a specific color to a specific location on the console.
+  inline void Canvas::Draw(char toWrite, float x, float y, Color color)
+  {
+    #ifdef RConsole_CLIP_CONSOLE
+
+    if (x >= width_) return;
+    if (y >= height_) return;
+		if (x <= 0) return;
+		if (y <= 0) return;
+
+    #endif // RConsole_CLIP_CONSOLE
+
+    target_->WriteChar(toWrite, x, y, color);
+  }
+
+  // Write the specific character in a specific color to a specific location on the console.
+  inline void Canvas::Draw(char toWrite, int x, int y, Color color)
+  {
+    Canvas::Draw(toWrite, static_cast<float>(x), static_cast<float>(y), color);
+  }
+
+  // Draw a string based on ints via std::string
+  inline void Canvas::DrawString(std::string toDraw, int xStart, int yStart, Color color)
+  {
+    Canvas::DrawString(toDraw.c_str(), static_cast<float>(xStart), static_cast<float>(yStart), color);
+  }
+
+  // Draw a string based on ints
+  inline void Canvas::DrawString(const char* toDraw, int xStart, int yStart, Color color)
+  {
+    Canvas::DrawString(toDraw, static_cast<float>(xStart), static_cast<float>(yStart), color);
+  }
+
+
+  // Draw a string based on floats via std::string
+  inline void Canvas::DrawString(std::string toDraw, float xStart, float yStart, Color color)
+  {
+    Canvas::DrawString(toDraw.c_str(), xStart, yStart, color);
+  }
+
+  // Draw a string
+  inline void Canvas::DrawString(const char* toDraw, float xStart, float yStart, Color color)
+  {
+	  size_t len = strlen(toDraw);
+	  if (len <= 0) return;
+
+    #ifdef RConsole_CLIP_CONSOLE
+    // Bounds check.
+    if (xStart > width_) return;
+    if (yStart > height_) return;
+    if (xStart < 0) return;
+    if (yStart < 0) return;
+
+	  // Find where the string starts in the raster.
+	  unsigned int index = static_cast<unsigned int>(xStart) + static_cast<unsigned int>(yStart) * width_;
+	  unsigned int length = width_ * height_;
+
+    // Trim index if past the end
+    if (index + len + 1 > length) 
+      return;
+
+    // Checks the length and adjusts if it will be past.
+    if (len + index >= length)
+      len = length - index;
+
+    #endif
+
+
+	  // Write string
+	  target_->WriteString(toDraw, len, xStart, yStart, color);
+  }
+
+  // Updates the current raster by drawing it to the screen.
+  inline bool Canvas::Update()
+  {
+    if (!isDrawing_) return false;
+
+    // The close handler only leaves a note: stopping the render thread from inside a signal
+    // handler could join it to itself, or wait on a lock the interrupted code holds.
+    if (closeSignal_ != 0)
+      closeFromSignal();
+    
+    if (!hasLazyInit_)
+    {
+      setCloseHandler();
+      hasLazyInit_ = true;
+    }
+
+    const bool isProfiling = isProfiling_;
+    std::chrono::steady_clock::time_point mark;
+    if (isProfiling)
+      mark = std::chrono::steady_clock::now();
+
+    composeLayers();
+
+  #ifndef RConsole_NO_THREADING
+    // Hand the frame to the render thread and get a raster back to draw the next one.
+    if (isRendering_)
+    {
+      pipeline_.Publish(r_);
+      wakeRenderThread();
+      clearForDrawing(r_);
+      if (isProfiling)
+        markStage(STAGE_COPY, mark);
+      return true;
+    }
+  #endif
+
+    std::chrono::steady_clock::duration composing;
+    if (isProfiling)
+      composing = std::chrono::steady_clock::now() - mark;
+
+    presentFrame(r_);
+
+    // Make this frame the previous one by swapping the buffers, then clear the new back
+    // buffer for drawing. Only the spans drawn the frame before last get cleared.
+    // Compositing counts toward the copy as well.
+    if (isProfiling)
+      mark = std::chrono::steady_clock::now() - composing;
+    r_.Swap(prev_);
+    clearForDrawing(r_);
+    if (isProfiling)
+      markStage(STAGE_COPY, mark);
+    return true;
+  }
+
+
+  // Draws a sprite with its top left corner at x, y. Anything off the canvas is clipped.
+  inline void Canvas::DrawSprite(const Sprite &sprite, int x, int y)
+  {
+    target_->WriteSprite(sprite, x, y);
+  }
+
+
+  // Draws count single glyphs at once, the i-th at x[i], y[i] in colors[i]. Comes out the
+  // same as calling Draw on each in order, without paying for a call and a clip per point.
+  // Points off the canvas are skipped.
+  inline void Canvas::DrawPoints(const float *x, const float *y, const char *glyphs, const Color *colors, size_t count)
+  {
+    target_->WritePoints(x, y, glyphs, colors, count);
+  }
+
+
+  // Picks where drawing calls go from here on. Drawing to a static layer is kept across
+  // frames until that layer is cleared, and costs a recomposite at the next Update, so
+  // it's for things that change now and then rather than every frame.
+  inline void Canvas::SetLayer(CanvasLayer layer)
+  {
+    if (layer != LAYER_DYNAMIC)
+    {
+      ensureLayers();
+      layersChanged_ = true;
+    }
+
+    layer_ = layer;
+    target_ = &layerRaster(layer);
+  }
+
+
+  // The layer drawing calls currently go to.
+  inline CanvasLayer Canvas::GetLayer()
+  {
+    return layer_;
+  }
+
+
+  // Erases everything drawn to a layer. The dynamic layer is cleared by every Update anyway.
+  inline void Canvas::ClearLayer(CanvasLayer layer)
+  {
+    if (layer == LAYER_DYNAMIC)
+    {
+      clearForDrawing(r_);
+      return;
+    }
+
+    ensureLayers();
+    layerRaster(layer).Zero();
+    layersChanged_ = true;
+  }
+
+
+  // Draws a point with ASCII to attempt to represent alpha values in 4 steps.
+  inline void Canvas::DrawAlpha(float x, float y, Color color, float opacity)
+  {
+    // All characters use represent alt-codes. 
+    if (opacity < .25)
+      Draw(static_cast<unsigned char>(176), x, y, color);
+    else if (opacity < .5)
+      Draw(static_cast<unsigned char>(177), x, y, color);
+    else if (opacity < .75)
+      Draw(static_cast<unsigned char>(178), x, y, color);
+    else
+      Draw(static_cast<unsigned char>(219), x, y, color);
+  }
+
+
+  // Stops the update loop.
+  inline void Canvas::Shutdown()
+  {
+    isDrawing_ = false;
+    StopRenderThread();
+    if (outputFile_)
+      fflush(outputFile_);
+  }
+
+
+  // Draws a point with ASCII to attempt to represent location in a square.
+  inline void Canvas::DrawPartialPoint(float x, float y, Color color)
+  {
+    // Get first two decimal places from location.
+    int xDec = static_cast<int>(x * 100) % 100;
+    int yDec = static_cast<int>(x * 100) % 100;
+
+
+    UNUSED(xDec);
+    UNUSED(yDec);
+
+
+    //If Y is closer to a border, use it for placement.
+    if (RFuncs::Abs(50 - static_cast<int>(x)) < RFuncs::Abs(50 - static_cast<int>(y)))
+    {
+      if (x > 50)
+        return Draw(static_cast<unsigned char>(222), x, y, color);
+      return Draw(static_cast<unsigned char>(221), x, y, color);
+    }
+    //Otherwise, X is closer to a border.
+    else
+    {
+      if (y > 50)
+        return Draw(static_cast<unsigned char>(223), x, y, color);
+      return Draw(static_cast<unsigned char>(220), x, y, color);
+    }
+  }
+
+  // Drawing box
+  inline void Canvas::DrawBox(char toWrite, float x1, float y1, float x2, float y2, Color color)
+  {
+    
+    if(x1 > x2)
+    {
+      float temp = x1;
+      x2 = x1;
+      temp = x2;
+    }
+    if(y1 > y2)
+    {
+      float temp = y1;
+      y2 = y1;
+      temp = y2;
+    }
+
+    // At this point it can be assumed that x1 and y1 and lower than x2 and y2 respectively.
+
+    for(unsigned int x = static_cast<unsigned int>(x1); x < x2; ++x)
+    {
+      for(unsigned int y = static_cast<unsigned int>(x1); y < y2; ++y)
+      {
+        Draw(toWrite, static_cast<float>(x), static_cast<float>(y), color);
+      }
+    }
+  }
+
+
+  //Set visibility of cursor to specified bool.
+  inline void Canvas::SetCursorVisible(bool isVisible)
+  {
+    if (outputTarget_ != TARGET_TERMINAL)
+      return;
+
+    const bool wasRendering = pauseRenderThread();
+    if (!isVisible)
+      rlutil::hidecursor();
+    else
+      rlutil::showcursor();
+    resumeRenderThread(wasRendering);
+  }
+
+
+  // Gets the width of the console
+  inline unsigned int Canvas::GetConsoleWidth()
+  {
+    return width_;
+  }
+
+
+  // Gets the height of the console
+  inline unsigned int Canvas::GetConsoleHeight()
+  {
+    return height_;
+  }
+
+
+  // Choose how frames reach the terminal. Buffered output is ANSI, so on Windows it needs
+  // a console with virtual terminal processing.
+  inline void Canvas::SetOutputMode(OutputMode mode)
+  {
+    // Headless targets only take buffered frames.
+    if (outputTarget_ != TARGET_TERMINAL)
+      return;
+
+    const bool wasRendering = pauseRenderThread();
+    outputMode_ = mode;
+    lastFrameBytes_ = 0;
+    forgetTerminalState();
+    resumeRenderThread(wasRendering);
+  }
+
+
+  // Gets how frames currently reach the terminal.
+  inline OutputMode Canvas::GetOutputMode()
+  {
+    return outputMode_;
+  }
+
+
+  // Sends frames somewhere other than the terminal, or back to it. TARGET_FILE opens path,
+  // truncating it, and returns false (changing nothing) if it can't. Headless targets switch
+  // to buffered output, and the first frame to one starts with a clear so the capture
+  // stands on its own.
+  inline bool Canvas::SetOutputTarget(OutputTarget target, const char *path)
+  {
+    FILE *file = nullptr;
+    if (target == TARGET_FILE)
+    {
+      if (!path || !(file = fopen(path, "wb")))
+        return false;
+    }
+
+    const bool wasRendering = pauseRenderThread();
+    if (outputFile_)
+      fclose(outputFile_);
+
+    outputFile_ = file;
+    outputTarget_ = target;
+    if (target != TARGET_TERMINAL)
+    {
+      outputMode_ = OUTPUT_BUFFERED;
+      clearPending_ = true;
+    }
+
+    lastFrameBytes_ = 0;
+    forgetTerminalState();
+    resumeRenderThread(wasRendering);
+    return true;
+  }
+
+
+  // Gets where frames currently go.
+  inline OutputTarget Canvas::GetOutputTarget()
+  {
+    return outputTarget_;
+  }
+
+
+  // Everything written to TARGET_MEMORY so far. Only read while the render thread is stopped.
+  inline const std::vector<char> &Canvas::GetCapturedOutput()
+  {
+    return captured_;
+  }
+
+
+  // Drops what TARGET_MEMORY has collected, keeping the storage.
+  inline void Canvas::ClearCapturedOutput()
+  {
+    const bool wasRendering = pauseRenderThread();
+    captured_.clear();
+    resumeRenderThread(wasRendering);
+  }
+
+
+  // Toggle cursor and color tracking in buffered mode. When on (the default), cells that are
+  // already under the cursor or already in the right color skip the escape sequences.
+  inline void Canvas::SetOutputMinimized(bool isMinimized)
+  {
+    const bool wasRendering = pauseRenderThread();
+    minimizeOutput_ = isMinimized;
+    forgetTerminalState();
+    resumeRenderThread(wasRendering);
+  }
+
+
+  // Number of bytes the last Update wrote to the terminal. Only tracked in buffered mode.
+  inline size_t Canvas::GetLastFrameBytes()
+  {
+    return lastFrameBytes_;
+  }
+
+
+  // Number of changed runs of cells the last frame written out had. 0 means the screen
+  // didn't change, which callers can use to slow down while nothing is moving.
+  inline size_t Canvas::GetLastFrameChanges()
+  {
+    return lastFrameChanges_;
+  }
+
+
+  // Number of cells the diff had to look at for the last frame written out: the spans
+  // drawn to it or the frame before, or all of them when the static layers changed.
+  inline size_t Canvas::GetLastFrameScanned()
+  {
+    return lastFrameScanned_;
+  }
+
+
+  // Times each stage of getting a frame out, or stops. Off, it costs a flag check per frame.
+  inline void Canvas::SetProfiling(bool isProfiling)
+  {
+    isProfiling_ = isProfiling;
+  }
+
+
+  // How long a stage took the last time it ran, in microseconds. Stages that run on the
+  // render thread report whichever frame it wrote last.
+  inline long Canvas::GetStageMicroseconds(CanvasStage stage)
+  {
+    return stageMicroseconds_[stage];
+  }
+
+
+  // Total frames handed to the render thread that were replaced by a newer one before it
+  // could write them out. A count that keeps climbing means the terminal can't keep up.
+  // Always 0 without the render thread, since every Update writes its frame.
+  inline size_t Canvas::GetDroppedFrames()
+  {
+  #ifndef RConsole_NO_THREADING
+    return pipeline_.GetDropped();
+  #else
+    return 0;
+  #endif
+  }
+
+    //////////////////////////////
+   // Private Member Functions //
+  //////////////////////////////
+  // Clears out the screen based on the previous items written. Clear character is a space.
+  inline void Canvas::clearPrevious(const CanvasRaster &r)
+  {
+    // Walk through the changed cells, write over only what was modified.
+    for (size_t run = 0; run < runCount_; ++run)
+    {
+      for (unsigned int index = runs_[run].Begin; index < runs_[run].End; ++index)
+      {
+        // If the space is blank now. The runs only hold cells that changed, and a static
+        // layer's cells aren't flagged as modified but still get written.
+        const RasterInfo &ri = r.GetRasterData().Peek(index);
+        if (!ri.IsModified() && ri.GetValue() == 0)
+        {
+          // locate on screen and set color
+          moveCursor((index % width_) + 1, (index / width_) + 1);
+
+          emitChar(' ');
+        }
+      }
+    }
   }
 
 
-  // Clear out the screen that the user sees.
-  // Note: More expensive than clearing just the previous spaces
-  // but less expensive than clearing entire buffer with command.
-  inline void Canvas::FillCanvas(const RasterInfo &ri)
+  // Explicitly clears every possible index. This is expensive! 
+  inline void Canvas::fullClear()
   {
-    r_.Fill(ri);
+    // Headless, the clear goes out with the next frame instead.
+    if (outputTarget_ != TARGET_TERMINAL)
+    {
+      clearPending_ = true;
+      return;
+    }
+
+    const bool wasRendering = pauseRenderThread();
+  #if defined(_WIN32) && !defined(RLUTIL_USE_ANSI)
+    rlutil::cls();
+  #else
+    // What rlutil::cls prints, without the two size lookups it does first.
+    rlutil::RLUTIL_PRINT("\033[2J\033[H");
+  #endif
+    forgetTerminalState();
+    resumeRenderThread(wasRendering);
   }
 
-  // Write the specific character in a specific color to a specific location on the console.
-  inline void Canvas::Draw(char toWrite, float x, float y, Color color)
+  
+  // Set the color in the console using utility, if applicable.
+  inline void Canvas::setColor(const Color &color)
   {
-    #ifdef RConsole_CLIP_CONSOLE
-
-    if (x >= width_) return;
-    if (y >= height_) return;
-		if (x <= 0) return;
-		if (y <= 0) return;
-
-    #endif // RConsole_CLIP_CONSOLE
+    if (color == PREVIOUS_COLOR)
+      return;
 
-    modified_.GoTo(static_cast<int>(x), static_cast<int>(y));
-    modified_.Set(true);
-    r_.WriteChar(toWrite, x, y, color);
+    if (outputMode_ == OUTPUT_BUFFERED)
+      frame_.AppendColor(color);
+    else
+      rlutil::setColor(color);
   }
 
-  // Write the specific character in a specific color to a specific location on the console.
-  inline void Canvas::Draw(char toWrite, int x, int y, Color color)
-  {
-    Canvas::Draw(toWrite, static_cast<float>(x), static_cast<float>(y), color);
-  }
 
-  // Draw a string based on ints via std::string
-  inline void Canvas::DrawString(std::string toDraw, int xStart, int yStart, Color color)
+  // Move the cursor to the 1-based x, y location, directly or into the frame buffer.
+  inline void Canvas::moveCursor(unsigned int x, unsigned int y)
   {
-    Canvas::DrawString(toDraw.c_str(), static_cast<float>(xStart), static_cast<float>(yStart), color);
+    if (outputMode_ == OUTPUT_BUFFERED)
+      frame_.AppendLocate(x, y);
+    else
+      rlutil::locate(x, y);
   }
 
-  // Draw a string based on ints
-  inline void Canvas::DrawString(const char* toDraw, int xStart, int yStart, Color color)
+
+  // Print a character at the cursor, directly or into the frame buffer.
+  // Returns the character written, like putc.
+  inline int Canvas::emitChar(char character)
   {
-    Canvas::DrawString(toDraw, static_cast<float>(xStart), static_cast<float>(yStart), color);
+    if (outputMode_ == OUTPUT_BUFFERED)
+    {
+      frame_.Append(character);
+      return static_cast<unsigned char>(character);
+    }
+
+    return putC(character, stdout);
   }
 
 
-  // Draw a string based on floats via std::string
-  inline void Canvas::DrawString(std::string toDraw, float xStart, float yStart, Color color)
+  // Write the raster we were attempting to write.
+  inline bool Canvas::writeRaster(const CanvasRaster &r)
   {
-    Canvas::DrawString(toDraw.c_str(), xStart, yStart, color);
-  }
+    // Only the changed cells can have anything to print.
+    for (size_t run = 0; run < runCount_; ++run)
+    {
+      for (unsigned int index = runs_[run].Begin; index < runs_[run].End; ++index)
+      {
+        const RasterInfo& ri = r.GetRasterData().Peek(index);
 
-  // Draw a string
-  inline void Canvas::DrawString(const char* toDraw, float xStart, float yStart, Color color)
-  {
-	  size_t len = strlen(toDraw);
-	  if (len <= 0) return;
+        if (ri.GetValue() != 0 && prev_.GetRasterData().Peek(index) != ri)
+        {
+          unsigned int xLoc = (index % width_) + 1;
+          unsigned int yLoc = (index / width_) + 1;
 
-    #ifdef RConsole_CLIP_CONSOLE
-    // Bounds check.
-    if (xStart > width_) return;
-    if (yStart > height_) return;
-    if (xStart < 0) return;
-    if (yStart < 0) return;
+          // Handle clipping the console if we define that tag.
+        #ifdef RConsole_CLIP_CONSOLE
+          // Handle X
+          if (xLoc > width_)
+            return false;
 
-	  // Set the memory we are using to modified.
-	  modified_.GoTo(static_cast<int>(xStart), static_cast<int>(yStart));
-	  unsigned int index = modified_.GetIndex();
+          // Handle Y
+          if (yLoc > height_)
+            return false;
+        #endif
 
-    // Trim index if past the end
-    if (index + len + 1 > modified_.Length()) 
-      return;
 
-    // Checks the length and adjusts if it will be past.
-    int writeLen = static_cast<int>(len);
-    if (writeLen + index >= modified_.Length())
-      writeLen = static_cast<int>(modified_.Length()) - static_cast<int>(index);
+          // locate on screen and set color
+          moveCursor(xLoc, yLoc);
 
-    // If our length plus the index we are at exceeds the end of the buffer,
-    if(writeLen > 0)
-      memset(modified_.GetHead() + index, true, static_cast<size_t>(writeLen));
+          // Set color of cursor
+          setColor(ri.GetColor());
 
-    #else
+          // Print out to the console in the preferred fashion
+          int retVal = 0;
 
-    // Just blindly set modified for the length.
-    modified_.GoTo(static_cast<int>(xStart), static_cast<int>(yStart));
-    unsigned int index = modified_.GetIndex();
-	  memset(modified_.GetHead() + index, true, len);
+          retVal = emitChar(ri.GetValue());
 
-    #endif
+          if (!retVal)
+            return false;
+        }
+      }
+    }
+
+    // Return we successfully printed the raster!
+    return true;
+  }
+
+  // Buffered single pass over the changed cells. Handles both what clearPrevious and
+  // writeRaster would: cells that changed get their new character, and cells drawn last
+  // frame but not this one get blanked. Everything goes through emitCellMinimal, which
+  // skips cursor moves and color changes the terminal doesn't need.
+  inline void Canvas::writeFrameMinimal(const CanvasRaster &r)
+  {
+    const Field2D<RasterInfo> &curr = r.GetRasterData();
 
+    // PREVIOUS_COLOR glyphs take the color of the last glyph written this frame, or white
+    // for the first one, same as in the unminimized path.
+    Color frameColor = WHITE;
 
-	  // Write string
-	  r_.WriteString(toDraw, len, xStart, yStart, color);
+    for (size_t run = 0; run < runCount_; ++run)
+    {
+      const unsigned int row = runs_[run].Begin / width_;
+      for (unsigned int index = runs_[run].Begin; index < runs_[run].End; ++index)
+      {
+        const unsigned int col = index - row * width_;
+        const RasterInfo &ri = curr.Peek(index);
+        if (ri.GetValue() != 0)
+        {
+          if (ri.GetColor() != PREVIOUS_COLOR)
+            frameColor = ri.GetColor();
+          emitCellMinimal(r, col, row, ri.GetValue(), frameColor);
+        }
+        else
+          emitCellMinimal(r, col, row, ' ', PREVIOUS_COLOR);
+      }
+    }
   }
 
-  // Updates the current raster by drawing it to the screen.
-  inline bool Canvas::Update()
+
+  // Write a single cell at the 0-based x, y into the frame buffer, moving the cursor and
+  // changing color only when the tracked terminal state says it's needed. A PREVIOUS_COLOR
+  // blank is printed in whatever color is current, since a space looks the same in all of them.
+  inline void Canvas::emitCellMinimal(const CanvasRaster &r, unsigned int x, unsigned int y, char value, Color color)
   {
-    if (!isDrawing_) return false;
-    
-    if (!hasLazyInit_)
+    // Get the cursor there: nothing if it's already in place, a short rewrite of the cells
+    // in between or a relative move if it's just behind on the same row, otherwise a full move.
+    if (termX_ == UINT_MAX || termY_ != y || termX_ > x)
     {
-      setCloseHandler();
-      hasLazyInit_ = true;
+      frame_.AppendLocate(x + 1, y + 1);
+    }
+    else if (termX_ < x)
+    {
+      const unsigned int gap = x - termX_;
+      if (!rewriteGap(r, termX_, y, gap))
+        frame_.AppendCursorForward(gap);
     }
 
-    clearPrevious();
-    writeRaster(r_);
-    
-    // Write and reset the raster.
-    memcpy(prev_.GetRasterData().GetHead(), r_.GetRasterData().GetHead(), width_ * height_ * sizeof(RasterInfo));
-    r_.Zero();
+    if (color != PREVIOUS_COLOR && color != termColor_)
+    {
+      frame_.AppendColor(color);
+      termColor_ = color;
+    }
 
-    rlutil::setColor(WHITE);
+    frame_.Append(value);
+    termX_ = x + 1;
+    termY_ = y;
+  }
+
+
+  // Attempts to step the cursor forward by reprinting what is already on screen, which is
+  // cheaper than an escape sequence for short gaps. Only possible if every cell in the gap
+  // is unchanged and either blank or already in the current color. Returns if it did.
+  inline bool Canvas::rewriteGap(const CanvasRaster &r, unsigned int x, unsigned int y, unsigned int length)
+  {
+    // "\033[" + digits + "C" is at least 4 bytes; anything longer isn't worth reprinting.
+    if (length > 4 || termColor_ == PREVIOUS_COLOR)
+      return false;
+
+    const Field2D<RasterInfo> &curr = r.GetRasterData();
+    const Field2D<RasterInfo> &prev = prev_.GetRasterData();
+    const unsigned int start = x + y * width_;
+    char run[4];
 
+    for (unsigned int i = 0; i < length; ++i)
+    {
+      const RasterInfo &ri = curr.Peek(start + i);
+      if (ri != prev.Peek(start + i))
+        return false;
+
+      if (ri.GetValue() == 0)
+        run[i] = ' ';
+      else if (ri.GetColor() == termColor_)
+        run[i] = ri.GetValue();
+      else
+        return false;
+    }
+
+    frame_.Append(run, length);
     return true;
   }
 
 
-  // Draws a point with ASCII to attempt to represent alpha values in 4 steps.
-  inline void Canvas::DrawAlpha(float x, float y, Color color, float opacity)
+  // First row drawn to this frame or the last one. Frames cleared to different bases can
+  // differ anywhere.
+  inline unsigned int Canvas::frameRowBegin(const CanvasRaster &r)
   {
-    // All characters use represent alt-codes. 
-    if (opacity < .25)
-      Draw(static_cast<unsigned char>(176), x, y, color);
-    else if (opacity < .5)
-      Draw(static_cast<unsigned char>(177), x, y, color);
-    else if (opacity < .75)
-      Draw(static_cast<unsigned char>(178), x, y, color);
-    else
-      Draw(static_cast<unsigned char>(219), x, y, color);
+    if (r.GetGeneration() != prev_.GetGeneration())
+      return 0;
+
+    const unsigned int currBegin = r.GetDirtyRowBegin();
+    const unsigned int prevBegin = prev_.GetDirtyRowBegin();
+    return currBegin < prevBegin ? currBegin : prevBegin;
   }
 
 
-  // Stops the update loop.
-  inline void Canvas::Shutdown()
+  // One past the last row drawn to this frame or the last one.
+  inline unsigned int Canvas::frameRowEnd(const CanvasRaster &r)
   {
-    isDrawing_ = false;
+    if (r.GetGeneration() != prev_.GetGeneration())
+      return height_;
+
+    const unsigned int currEnd = r.GetDirtyRowEnd();
+    const unsigned int prevEnd = prev_.GetDirtyRowEnd();
+    return currEnd > prevEnd ? currEnd : prevEnd;
   }
 
 
-  // Draws a point with ASCII to attempt to represent location in a square.
-  inline void Canvas::DrawPartialPoint(float x, float y, Color color)
+  // Columns of a row that can differ between this frame and the last one: anything
+  // drawn in either. Everything outside of it is the same base in both rasters.
+  inline RowSpan Canvas::frameSpan(const CanvasRaster &r, unsigned int row)
   {
-    // Get first two decimal places from location.
-    int xDec = static_cast<int>(x * 100) % 100;
-    int yDec = static_cast<int>(x * 100) % 100;
+    if (r.GetGeneration() != prev_.GetGeneration())
+      return RowSpan(0, width_);
 
+    const RowSpan &curr = r.GetRowSpan(row);
+    const RowSpan &prev = prev_.GetRowSpan(row);
+    if (curr.Empty())
+      return prev;
+    if (prev.Empty())
+      return curr;
 
-    UNUSED(xDec);
-    UNUSED(yDec);
+    return RowSpan(curr.Begin < prev.Begin ? curr.Begin : prev.Begin, curr.End > prev.End ? curr.End : prev.End);
+  }
 
 
-    //If Y is closer to a border, use it for placement.
-    if (RFuncs::Abs(50 - static_cast<int>(x)) < RFuncs::Abs(50 - static_cast<int>(y)))
-    {
-      if (x > 50)
-        return Draw(static_cast<unsigned char>(222), x, y, color);
-      return Draw(static_cast<unsigned char>(221), x, y, color);
-    }
-    //Otherwise, X is closer to a border.
-    else
+  // Fills runs_ with every cell the frame has to write, scanning only the frame spans.
+  inline void Canvas::findChanges(const CanvasRaster &r)
+  {
+    // Worst case is every other cell changing, which never merges into longer runs.
+    const size_t maxRuns = static_cast<size_t>((width_ + 1) / 2) * height_;
+    if (runs_.size() < maxRuns)
+      runs_.resize(maxRuns);
+
+    const RasterDiff::FindChangesFunc kernel = RasterDiff::GetFindChanges();
+    const RasterInfo *curr = r.GetRasterData().GetHead();
+    const RasterInfo *prev = prev_.GetRasterData().GetHead();
+    runCount_ = 0;
+    size_t scanned = 0;
+    const unsigned int rowEnd = frameRowEnd(r);
+    for (unsigned int row = frameRowBegin(r); row < rowEnd; ++row)
     {
-      if (y > 50)
-        return Draw(static_cast<unsigned char>(223), x, y, color);
-      return Draw(static_cast<unsigned char>(220), x, y, color);
+      const RowSpan span = frameSpan(r, row);
+      if (span.Empty())
+        continue;
+
+      scanned += span.End - span.Begin;
+      const unsigned int offset = row * width_;
+      runCount_ += kernel(curr, prev, offset + span.Begin, offset + span.End, runs_.data() + runCount_);
     }
+
+    lastFrameScanned_ = scanned;
   }
 
-  // Drawing box
-  inline void Canvas::DrawBox(char toWrite, float x1, float y1, float x2, float y2, Color color)
+
+  // Writes out everything that differs between a finished raster and prev_, which holds
+  // what is currently on screen. Runs on whichever thread owns prev_.
+  inline void Canvas::presentFrame(const CanvasRaster &r)
   {
-    
-    if(x1 > x2)
+    const bool isProfiling = isProfiling_;
+    std::chrono::steady_clock::time_point mark;
+    if (isProfiling)
+      mark = std::chrono::steady_clock::now();
+
+    frame_.Clear();
+    if (clearPending_)
     {
-      float temp = x1;
-      x2 = x1;
-      temp = x2;
+      if (outputMode_ == OUTPUT_BUFFERED)
+        frame_.Append("\033[2J", 4);
+      else
+        rlutil::cls();
+      clearPending_ = false;
     }
-    if(y1 > y2)
+
+    findChanges(r);
+    lastFrameChanges_ = runCount_;
+    if (isProfiling)
+      markStage(STAGE_DIFF, mark);
+
+    const bool isMinimal = outputMode_ == OUTPUT_BUFFERED && minimizeOutput_;
+    if (isMinimal)
     {
-      float temp = y1;
-      y2 = y1;
-      temp = y2;
+      if (isProfiling)
+        stageMicroseconds_[STAGE_CLEAR_PREVIOUS] = 0;
+      writeFrameMinimal(r);
+    }
+    else
+    {
+      clearPrevious(r);
+      if (isProfiling)
+        markStage(STAGE_CLEAR_PREVIOUS, mark);
+      writeRaster(r);
     }
 
-    // At this point it can be assumed that x1 and y1 and lower than x2 and y2 respectively.
+    // The minimal emitter remembers the color between frames instead of resetting it.
+    if (!isMinimal)
+      setColor(WHITE);
 
-    for(unsigned int x = static_cast<unsigned int>(x1); x < x2; ++x)
+    // Hand the whole frame over at once.
+    if (outputMode_ == OUTPUT_BUFFERED)
     {
-      for(unsigned int y = static_cast<unsigned int>(x1); y < y2; ++y)
+      lastFrameBytes_ = frame_.Size();
+      if (outputTarget_ == TARGET_MEMORY)
+        frame_.FlushTo(captured_);
+      else if (outputTarget_ == TARGET_FILE)
+        frame_.FlushTo(outputFile_);
+      else
+        frame_.Flush();
+    }
+
+    if (isProfiling)
+      markStage(STAGE_WRITE_RASTER, mark);
+  }
+
+
+  // Sizes the static layers and base_ to the canvas, empty, the first time they're used.
+  inline void Canvas::ensureLayers()
+  {
+    if (hasLayers_)
+      return;
+
+    backLayer_.Resize(width_, height_);
+    frontLayer_.Resize(width_, height_);
+    backLayer_.Zero();
+    frontLayer_.Zero();
+    base_.Resize(width_, height_);
+    hasLayers_ = true;
+    layersChanged_ = true;
+  }
+
+
+  // Brings r_ in line with the static layers before it goes out. When they've changed,
+  // base_ is rebuilt and every cell of r_ that wasn't drawn this frame takes it up. The
+  // rest of the time the base is already in r_, and only the front layer has to be laid
+  // back over what was drawn this frame, which is all inside r_'s spans.
+  inline void Canvas::composeLayers()
+  {
+    if (!hasLayers_)
+      return;
+
+    const RasterInfo *back = backLayer_.GetRasterData().GetHead();
+    const RasterInfo *front = frontLayer_.GetRasterData().GetHead();
+    RasterInfo *curr = r_.data_.GetHead();
+    if (layersChanged_)
+    {
+      if (++generation_ == CanvasRaster::ZeroGeneration || generation_ == CanvasRaster::UnknownGeneration)
+        generation_ = CanvasRaster::ZeroGeneration + 1;
+
+      RasterInfo *base = base_.GetHead();
+      const unsigned int length = width_ * height_;
+      for (unsigned int i = 0; i < length; ++i)
       {
-        Draw(toWrite, static_cast<float>(x), static_cast<float>(y), color);
+        base[i] = front[i].GetValue() != 0 ? front[i] : back[i];
+        base[i].SetModified(false);
+
+        if (!curr[i].IsModified())
+          curr[i] = base[i];
+        else if (front[i].GetValue() != 0)
+          curr[i] = front[i];
       }
+
+      r_.generation_ = generation_;
+      layersChanged_ = false;
+      return;
+    }
+
+    const unsigned int rowBegin = r_.dirtyRowBegin_ > frontLayer_.dirtyRowBegin_ ? r_.dirtyRowBegin_ : frontLayer_.dirtyRowBegin_;
+    const unsigned int rowEnd = r_.dirtyRowEnd_ < frontLayer_.dirtyRowEnd_ ? r_.dirtyRowEnd_ : frontLayer_.dirtyRowEnd_;
+    for (unsigned int row = rowBegin; row < rowEnd; ++row)
+    {
+      const RowSpan &drawn = r_.spans_[row];
+      const RowSpan &covered = frontLayer_.spans_[row];
+      const unsigned int begin = drawn.Begin > covered.Begin ? drawn.Begin : covered.Begin;
+      const unsigned int end = drawn.End < covered.End ? drawn.End : covered.End;
+      for (unsigned int i = row * width_ + begin; i < row * width_ + end; ++i)
+        if (front[i].GetValue() != 0)
+          curr[i] = front[i];
     }
   }
 
 
-  //Set visibility of cursor to specified bool.
-  inline void Canvas::SetCursorVisible(bool isVisible)
+  // Clears a raster for drawing the next frame on: back to base_ with static layers in
+  // use, otherwise to blank.
+  inline void Canvas::clearForDrawing(CanvasRaster &r)
   {
-    if (!isVisible)
-      rlutil::hidecursor();
+    if (hasLayers_)
+      r.Restore(base_, generation_);
     else
-      rlutil::showcursor();
+      r.Zero();
   }
 
 
-  // Gets the width of the console
-  inline unsigned int Canvas::GetConsoleWidth()
+  // The raster behind a layer.
+  inline CanvasRaster &Canvas::layerRaster(CanvasLayer layer)
   {
-    return width_;
+    if (layer == LAYER_BACK)
+      return backLayer_;
+    if (layer == LAYER_FRONT)
+      return frontLayer_;
+
+    return r_;
   }
 
 
-  // Gets the height of the console
-  inline unsigned int Canvas::GetConsoleHeight()
+  // Spins up the render thread. Does nothing if it's already running, or if threading
+  // is compiled out.
+  inline void Canvas::StartRenderThread()
   {
-    return height_;
+  #ifndef RConsole_NO_THREADING
+    if (isRendering_)
+      return;
+
+    pipeline_.Reset(width_, height_);
+    isRendering_ = true;
+
+    // The thread starts with close signals blocked, so they're always delivered to the
+    // threads that draw.
+  #ifndef _WIN32
+    sigset_t closeSignals;
+    sigset_t previous;
+    sigemptyset(&closeSignals);
+    sigaddset(&closeSignals, SIGINT);
+    sigaddset(&closeSignals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &closeSignals, &previous);
+    renderThread_ = std::thread(renderLoop);
+    pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+  #else
+    renderThread_ = std::thread(renderLoop);
+  #endif
+  #endif
   }
 
-    //////////////////////////////
-   // Private Member Functions //
-  //////////////////////////////
-  // Clears out the screen based on the previous items written. Clear character is a space.
-  inline void Canvas::clearPrevious()
-  {
-    // Walk through, write over only what was modified.
-    modified_.SetIndex(0);
-    unsigned int maxIndex = width_ * height_;
-    unsigned int index = 0;
-    while (index < maxIndex)
-    {
-      index = modified_.GetIndex();
-      const RasterInfo &curr = r_.GetRasterData().Peek(index);
-      const RasterInfo &prev = prev_.GetRasterData().Peek(index);
-
-      // If we have not modified the space,
-      // and we don't have the same character as last time,
-      // and we don't have the same color.
-      if (!modified_.Get() && curr != prev)
-      {
-        // Compute X and Y location
-        unsigned int xLoc = (index % width_) + 1;
-        unsigned int yLoc = (index / width_) + 1;
 
-        // locate on screen and set color
-        rlutil::locate(xLoc, yLoc);
+  // Stops the render thread once it has written out the last frame handed to it.
+  inline void Canvas::StopRenderThread()
+  {
+  #ifndef RConsole_NO_THREADING
+    if (!isRendering_)
+      return;
+
+    isRendering_ = false;
+    wakeRenderThread();
+    if (renderThread_.joinable())
+      renderThread_.join();
+  #endif
+  }
 
-        putC(' ', stdout);
-      }
-      modified_.IncrementX();
-    }
 
-    // Set things back to zero.
-    modified_.Zero();
+  // If Update is handing frames off to the render thread.
+  inline bool Canvas::IsRenderThreadRunning()
+  {
+  #ifndef RConsole_NO_THREADING
+    return isRendering_;
+  #else
+    return false;
+  #endif
   }
 
 
-  // Explicitly clears every possible index. This is expensive! 
-  inline void Canvas::fullClear()
+  // Stops the render thread so the calling thread can touch output state, returning
+  // if it was running. Pair with resumeRenderThread.
+  inline bool Canvas::pauseRenderThread()
   {
-    rlutil::cls();
+    const bool wasRunning = IsRenderThreadRunning();
+    StopRenderThread();
+    return wasRunning;
   }
 
-  
-  // Set the color in the console using utility, if applicable.
-  inline void Canvas::setColor(const Color &color)
+
+  // Restarts the render thread if pauseRenderThread stopped it.
+  inline void Canvas::resumeRenderThread(bool wasRunning)
   {
-    if (color != PREVIOUS_COLOR)
-      rlutil::setColor(color);
+    if (wasRunning)
+      StartRenderThread();
   }
 
 
-  // Write the raster we were attempting to write.
-  inline bool Canvas::writeRaster(CanvasRaster &r)
+  // Render thread body: wait for a finished raster, write it out, keep it as what's on
+  // screen. The raster that was on screen goes back to the pipeline for reuse.
+  inline void Canvas::renderLoop()
   {
-    // Set initial position.
-    unsigned int maxIndex = width_ * height_;
-    r.GetRasterData().SetIndex(0);
-    unsigned int index = 0;
-    while(index < maxIndex)
+  #ifndef RConsole_NO_THREADING
+    while (isRendering_)
     {
-      index = r.GetRasterData().GetIndex();
-      const RasterInfo& ri = r.GetRasterData().Get();
-
-      if (ri.Value != 0 && prev_.GetRasterData().Peek(index) != ri)
+      // Sleeps until there's a frame or it's told to stop; no polling while idle.
       {
-        unsigned int xLoc = (index % width_) + 1;
-        unsigned int yLoc = (index / width_) + 1;
-
-        // Handle clipping the console if we define that tag.
-      #ifdef RConsole_CLIP_CONSOLE
-        // Handle X
-        if (xLoc > width_)
-          return false;
-
-        // Handle Y
-        if (yLoc > height_)
-          return false;
-      #endif
+        std::unique_lock<std::mutex> lock(renderMutex_);
+        renderWake_.wait(lock, []() { return !isRendering_ || pipeline_.HasFresh(); });
+      }
 
+      if (pipeline_.Acquire())
+      {
+        CanvasRaster &frame = pipeline_.Front();
+        presentFrame(frame);
+        prev_.Swap(frame);
+      }
+    }
 
-        // locate on screen and set color
-        rlutil::locate(xLoc, yLoc);
+    // Write out the last frame handed off before stopping, so the screen matches it.
+    if (pipeline_.Acquire())
+    {
+      CanvasRaster &frame = pipeline_.Front();
+      presentFrame(frame);
+      prev_.Swap(frame);
+    }
+  #endif
+  }
 
-        // Set color of cursor
-        setColor(ri.C);
 
-        // Print out to the console in the preferred fashion
-        int retVal = 0;
+  // Tells the render thread something changed. Taking the lock, even empty, orders this
+  // after the render thread's last look at the pipeline, so the wakeup can't be missed.
+  inline void Canvas::wakeRenderThread()
+  {
+  #ifndef RConsole_NO_THREADING
+    {
+      std::lock_guard<std::mutex> lock(renderMutex_);
+    }
+    renderWake_.notify_one();
+  #endif
+  }
 
-        retVal = putC(ri.Value, stdout);
 
-        if (!retVal)
-          return false;
-      }
+  // Stores how long a stage took, from mark until now, and moves mark up to now for the next stage.
+  inline void Canvas::markStage(CanvasStage stage, std::chrono::steady_clock::time_point &mark)
+  {
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    stageMicroseconds_[stage] = static_cast<long>(std::chrono::duration_cast<std::chrono::microseconds>(now - mark).count());
+    mark = now;
+  }
 
-      // Increment X location
-      r.GetRasterData().IncrementX();
-    }
 
-    // Return we successfully printed the raster!
-    return true;
+  // Drop what we think the terminal cursor and color are, forcing the next frame to set both.
+  inline void Canvas::forgetTerminalState()
+  {
+    termX_ = UINT_MAX;
+    termY_ = UINT_MAX;
+    termColor_ = PREVIOUS_COLOR;
   }
 
+
   // Cross-platform putc
   inline int Canvas::putC(int character, FILE * stream )
   {
@@ -1579,12 +3979,12 @@ namespace RConsole
         const RasterInfo &ri = r_.GetRasterData().Peek(j, i);
         if (fp == stdout)
         {
-          rlutil::setColor(ri.C);
-          std::cout << ri.Value;//fprintf(fp, "%c", ri.Value);
+          rlutil::setColor(ri.GetColor());
+          std::cout << ri.GetValue();//fprintf(fp, "%c", ri.GetValue());
         }
         else
         {
-          std::string line = rlutil::getANSIColor(ri.C) + ri.Value;
+          std::string line = rlutil::getANSIColor(ri.GetColor()) + ri.GetValue();
           fprintf(fp, "%s", line.c_str());
         }
       }
@@ -1612,7 +4012,7 @@ namespace RConsole
     {
       for (unsigned int j = 0; j < height_; ++j)
       {
-        if (r_.GetRasterData().Peek(i, j).Value != toTrim)
+        if (r_.GetRasterData().Peek(i, j).GetValue() != toTrim)
         {
           if (i < Xmin) Xmin = i;
           if (j < Ymin) Ymin = j;
@@ -1634,12 +4034,12 @@ namespace RConsole
         const RasterInfo &ri = r_.GetRasterData().Peek(i, j);
         if (fp == stdout)
         {
-          rlutil::setColor(ri.C);
-          fprintf(fp, "%c", ri.Value);
+          rlutil::setColor(ri.GetColor());
+          fprintf(fp, "%c", ri.GetValue());
         }
         else
         {
-          std::string line = rlutil::getANSIColor(ri.C) + ri.Value;
+          std::string line = rlutil::getANSIColor(ri.GetColor()) + ri.GetValue();
           fprintf(fp, "%s", line.c_str());
         }
       }
@@ -1653,24 +4053,32 @@ namespace RConsole
   }
 
 
-  // Handle closing the window
-  static void signalHandler(int signalNum)
+  // Handle closing the window. Only notes the signal; the next Update does the closing.
+  inline void Canvas::onCloseSignal(int signalNum)
   {
-    Canvas::Shutdown();
-    std::this_thread::sleep_for(std::chrono::milliseconds(500));
-    int height = rlutil::trows();
+    closeSignal_ = signalNum;
+  }
+
+  // Shuts down, leaves the cursor below everything drawn, and exits with the signal that
+  // asked for it.
+  inline void Canvas::closeFromSignal()
+  {
+    const int signalNum = closeSignal_;
+    Shutdown();
+    int height = TerminalSize::GetRows();
     rlutil::locate(0, height);
     rlutil::setColor(WHITE);
     std::cout << std::endl;
     exit(signalNum);
   }
+
   inline void Canvas::setCloseHandler()
   {
-    signal(SIGTERM, signalHandler);
-    signal(SIGINT, signalHandler);
+    signal(SIGTERM, onCloseSignal);
+    signal(SIGINT, onCloseSignal);
   }
 }
 
-#define CONSOLE_WIDTH_FUNC (rlutil::tcols() - 1)
-#define CONSOLE_HEIGHT_FUNC (rlutil::trows())
+#define CONSOLE_WIDTH_FUNC (RConsole::TerminalSize::GetColumns() - 1)
+#define CONSOLE_HEIGHT_FUNC (RConsole::TerminalSize::GetRows())
 
@@ -0,0 +1,76 @@
+// Runtime CPU feature detection, used to pick between SIMD code paths once at startup.
+// Only x86/x64 is probed; every other architecture reports scalar.
+#pragma once
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CPU_FEATURES_X86
+#endif
+
+#if defined(CPU_FEATURES_X86) && defined(_MSC_VER)
+#include <intrin.h>    // __cpuid, __cpuidex
+#include <immintrin.h> // _xgetbv
+#endif
+
+namespace CpuFeatures
+{
+  // Widest SIMD instruction set we are willing to use, in increasing order.
+  enum SimdLevel
+  {
+    SIMD_SCALAR,
+    SIMD_SSE2,
+    SIMD_AVX2
+  };
+
+  // Probes the processor (and OS register support) for the widest usable SIMD level.
+  inline SimdLevel DetectSimdLevel()
+  {
+#if defined(CPU_FEATURES_X86) && defined(_MSC_VER)
+    int info[4] = { 0 };
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+
+    __cpuid(info, 1);
+    const bool hasSSE2 = (info[3] & (1 << 26)) != 0;
+    const bool hasOSXSave = (info[2] & (1 << 27)) != 0;
+    const bool hasAVX = (info[2] & (1 << 28)) != 0;
+
+    bool hasAVX2 = false;
+    if (maxLeaf >= 7 && hasOSXSave && hasAVX)
+    {
+      // The OS has to save the upper halves of the YMM registers for AVX to be usable.
+      const bool osSavesYMM = (_xgetbv(0) & 0x6) == 0x6;
+      __cpuidex(info, 7, 0);
+      hasAVX2 = osSavesYMM && (info[1] & (1 << 5)) != 0;
+    }
+
+    if (hasAVX2) return SIMD_AVX2;
+    if (hasSSE2) return SIMD_SSE2;
+    return SIMD_SCALAR;
+#elif defined(CPU_FEATURES_X86) && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return SIMD_AVX2;
+    if (__builtin_cpu_supports("sse2")) return SIMD_SSE2;
+    return SIMD_SCALAR;
+#else
+    return SIMD_SCALAR;
+#endif
+  }
+
+  // Cached result of DetectSimdLevel.
+  inline SimdLevel GetSimdLevel()
+  {
+    static const SimdLevel level = DetectSimdLevel();
+    return level;
+  }
+
+  // Human readable name of a SIMD level, for benchmark and debug output.
+  inline const char *GetSimdLevelName(SimdLevel level)
+  {
+    switch (level)
+    {
+      case SIMD_AVX2: return "avx2";
+      case SIMD_SSE2: return "sse2";
+      default:        return "scalar";
+    }
+  }
+}